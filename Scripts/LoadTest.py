@@ -0,0 +1,98 @@
+#!/usr/bin/env python
+"""
+Network load test for CoopGame.
+
+Starts a -nullrhi dedicated server and N headless clients on localhost. The clients are driven by the
+scripted input bot (ASLoadTestBot) and the server records traffic, tick times and replicated classes
+(ASLoadTestReporter) until the test duration runs out, then writes its report and exits.
+
+Example:
+    python Scripts/LoadTest.py --engine "C:/UE_4.22/Engine/Binaries/Win64/UE4Editor.exe" --clients 8 --duration 180
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import time
+
+PROJECT_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), os.pardir))
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Run a dedicated server with headless bot clients and collect a network report.")
+    parser.add_argument("--engine", default=os.environ.get("UE4_EDITOR"), help="Path to UE4Editor(.exe), defaults to $UE4_EDITOR")
+    parser.add_argument("--project", default=os.path.join(PROJECT_DIR, "CoopGame.uproject"))
+    parser.add_argument("--map", default="/Game/Maps/Blockout_P")
+    parser.add_argument("--clients", type=int, default=8)
+    parser.add_argument("--duration", type=int, default=120, help="Seconds the server measures before writing the report")
+    parser.add_argument("--port", type=int, default=7777)
+    parser.add_argument("--stagger", type=float, default=2.0, help="Seconds between client launches")
+    parser.add_argument("--seed", type=int, default=1, help="Base seed, client i uses seed + i")
+    parser.add_argument("--report", default=None, help="Report file, defaults to Saved/LoadTest/LoadTest-<time>.txt")
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    if not args.engine or not os.path.isfile(args.engine):
+        sys.exit("Engine executable not found, pass --engine or set UE4_EDITOR")
+
+    report = args.report or os.path.join(PROJECT_DIR, "Saved", "LoadTest", time.strftime("LoadTest-%Y%m%d-%H%M%S.txt"))
+    log_dir = os.path.join(os.path.dirname(report), "Logs")
+    if not os.path.isdir(log_dir):
+        os.makedirs(log_dir)
+
+    server_cmd = [
+        args.engine, args.project, args.map,
+        "-server", "-nullrhi", "-nosound", "-unattended", "-log",
+        "-port=%d" % args.port,
+        "-LoadTest",
+        "-LoadTestDuration=%d" % args.duration,
+        "-LoadTestReport=%s" % report,
+        "-abslog=%s" % os.path.join(log_dir, "Server.log"),
+    ]
+
+    print("Starting server on port %d" % args.port)
+    server = subprocess.Popen(server_cmd)
+
+    # Give the server time to load the map before the first client connects
+    time.sleep(10.0)
+
+    clients = []
+    try:
+        for i in range(args.clients):
+            client_cmd = [
+                args.engine, args.project, "127.0.0.1:%d" % args.port,
+                "-game", "-nullrhi", "-nosound", "-unattended",
+                "-LoadTestBot",
+                "-LoadTestSeed=%d" % (args.seed + i),
+                "-abslog=%s" % os.path.join(log_dir, "Client%d.log" % i),
+            ]
+
+            print("Starting client %d" % i)
+            clients.append(subprocess.Popen(client_cmd))
+            time.sleep(args.stagger)
+
+        # The server exits by itself once the report is written
+        server.wait()
+    finally:
+        for client in clients:
+            if client.poll() is None:
+                client.terminate()
+
+        if server.poll() is None:
+            server.terminate()
+
+    if os.path.isfile(report):
+        with open(report) as report_file:
+            report_text = report_file.read()
+        print(report_text)
+        if "Dedicated server cosmetics check: FAILED" in report_text:
+            sys.exit("Dedicated server created cosmetic objects, see the [Cosmetics] section of the report")
+    else:
+        sys.exit("Server exited without writing a report, see %s" % os.path.join(log_dir, "Server.log"))
+
+
+if __name__ == "__main__":
+    main()
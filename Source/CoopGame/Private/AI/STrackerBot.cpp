@@ -11,6 +11,10 @@
 #include "SCharacter.h"
 #include "Components/SphereComponent.h"
 #include "Sound/SoundCue.h"
+#include "SCombatTelemetry.h"
+#include "SLagCompensation.h"
+#include "SFXPool.h"
+#include "SFXBudget.h"
 
 static int32 DebugTrackerBotDrawing = 0;
 FAutoConsoleVariableRef CVARDebugTrackerBotDrawing(
@@ -41,6 +45,8 @@ ASTrackerBot::ASTrackerBot()
 	SphereComp->SetCollisionResponseToChannel(ECC_Pawn, ECR_Overlap);
 	SphereComp->SetupAttachment(RootComponent);
 
+	Hitboxes.Add(FSHitbox::MakeCapsule("Body", NAME_None, 50.0f, 50.0f, 1.0f, SurfaceType_Default));
+
 	bUseVelocityChange = false;
 	MovementForce = 1000;
 	RequiredDistanceToTarget = 100;
@@ -65,19 +71,30 @@ void ASTrackerBot::BeginPlay()
 		FTimerHandle TimerHandle_CheckPowerLevel;
 		GetWorldTimerManager().SetTimer(TimerHandle_CheckPowerLevel, this, &ASTrackerBot::OnCheckNearbyBots, 1.0f, true);
 	}
+
+	ASWorldManager::Get<ASLagCompensation>(this)->RegisterPawn(this, &Hitboxes);
+
+	if (!IsNetMode(NM_DedicatedServer))
+	{
+		ASFXPool::Prewarm(this, ExplosionEffect, 2);
+	}
 }
 
 
 void ASTrackerBot::HandleTakeDamage(USHealthComponent* OwningHealthComp, float Health, float HealthDelta, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser)
 {
-	if (MatInst == nullptr)
+	// Damage flash, only where the bot is rendered
+	if (!IsNetMode(NM_DedicatedServer))
 	{
-		MatInst = MeshComp->CreateAndSetMaterialInstanceDynamicFromMaterial(0, MeshComp->GetMaterial(0));
-	}
+		if (MatInst == nullptr)
+		{
+			MatInst = MeshComp->CreateAndSetMaterialInstanceDynamicFromMaterial(0, MeshComp->GetMaterial(0));
+		}
 
-	if (MatInst)
-	{
-		MatInst->SetScalarParameterValue("LastTimeDamageTaken", GetWorld()->TimeSeconds);
+		if (MatInst)
+		{
+			MatInst->SetScalarParameterValue("LastTimeDamageTaken", GetWorld()->TimeSeconds);
+		}
 	}
 
 	// Explode on hitpoints == 0
@@ -101,7 +118,7 @@ FVector ASTrackerBot::GetNextPathPoint()
 			continue;
 		}
 
-		USHealthComponent* TestPawnHealthComp = Cast<USHealthComponent>(TestPawn->GetComponentByClass(USHealthComponent::StaticClass()));
+		USHealthComponent* TestPawnHealthComp = USHealthComponent::FindHealthComponent(TestPawn);
 		if (TestPawnHealthComp && TestPawnHealthComp->GetHealth() > 0.0f)
 		{
 			float Distance = (TestPawn->GetActorLocation() - GetActorLocation()).Size();
@@ -142,9 +159,18 @@ void ASTrackerBot::SelfDestruct()
 
 	bExploded = true;
 
-	UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ExplosionEffect, GetActorLocation());
+	ASEffectScheduler* Scheduler = ASWorldManager::Get<ASEffectScheduler>(this, false);
+	if (Scheduler)
+	{
+		Scheduler->StopEffect(SelfDamageEffect);
+	}
+
+	if (!IsNetMode(NM_DedicatedServer))
+	{
+		ASFXBudget::RequestEmitterAtLocation(this, ExplosionEffect, ESFXCategory::Explosion, GetActorLocation());
 
-	UGameplayStatics::PlaySoundAtLocation(this, ExplodeSound, GetActorLocation());
+		UGameplayStatics::PlaySoundAtLocation(this, ExplodeSound, GetActorLocation());
+	}
 
 	MeshComp->SetVisibility(false, true);
 	MeshComp->SetCollisionEnabled(ECollisionEnabled::NoCollision);
@@ -160,6 +186,8 @@ void ASTrackerBot::SelfDestruct()
 		// Apply Damage!
 		UGameplayStatics::ApplyRadialDamage(this, ActualDamage, GetActorLocation(), ExplosionRadius, nullptr, IgnoredActors, this, GetInstigatorController(), true);
 
+		FSCombatTelemetry::Record(ESTelemetryEvent::Explosion, this, nullptr, ActualDamage, ExplosionRadius);
+
 		if (DebugTrackerBotDrawing)
 		{
 			DrawDebugSphere(GetWorld(), GetActorLocation(), ExplosionRadius, 12, FColor::Red, false, 2.0f, 0, 1.0f);
@@ -231,12 +259,19 @@ void ASTrackerBot::NotifyActorBeginOverlap(AActor* OtherActor)
 			if (Role == ROLE_Authority)
 			{
 				// Start self destruction sequence
-				GetWorldTimerManager().SetTimer(TimerHandle_SelfDamage, this, &ASTrackerBot::DamageSelf, SelfDamageInterval, true, 0.0f);
+				ASEffectScheduler* Scheduler = ASWorldManager::Get<ASEffectScheduler>(this);
+				if (Scheduler)
+				{
+					SelfDamageEffect = Scheduler->StartEffect(FSEffectTickDelegate::CreateUObject(this, &ASTrackerBot::DamageSelf), SelfDamageInterval, 0, 0.0f);
+				}
 			}
 
 			bStartedSelfDestruction = true;
 
-			UGameplayStatics::SpawnSoundAttached(SelfDestructSound, RootComponent);
+			if (!IsNetMode(NM_DedicatedServer))
+			{
+				UGameplayStatics::SpawnSoundAttached(SelfDestructSound, RootComponent);
+			}
 		}
 	}
 }
@@ -284,8 +319,8 @@ void ASTrackerBot::OnCheckNearbyBots()
 	// Clamp between min=0 and max=4
 	PowerLevel = FMath::Clamp(NrOfBots, 0, MaxPowerLevel);
 
-	// Update the material color
-	if (MatInst == nullptr)
+	// Update the material color, nothing to see on a dedicated server
+	if (MatInst == nullptr && !IsNetMode(NM_DedicatedServer))
 	{
 		MatInst = MeshComp->CreateAndSetMaterialInstanceDynamicFromMaterial(0, MeshComp->GetMaterial(0));
 	}
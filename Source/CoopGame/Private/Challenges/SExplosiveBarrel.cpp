@@ -5,6 +5,8 @@
 #include "Kismet/GameplayStatics.h"
 #include "PhysicsEngine/RadialForceComponent.h"
 #include "Net/UnrealNetwork.h"
+#include "SCombatTelemetry.h"
+#include "SFXBudget.h"
 
 
 // Sets default values
@@ -17,6 +19,9 @@ ASExplosiveBarrel::ASExplosiveBarrel()
 	MeshComp->SetSimulatePhysics(true);
 	// Set to physics body to let radial component affect us (eg. when a nearby barrel explodes)
 	MeshComp->SetCollisionObjectType(ECC_PhysicsBody);
+	MeshComp->BodyInstance.bGenerateWakeEvents = true;
+	MeshComp->OnComponentWake.AddDynamic(this, &ASExplosiveBarrel::OnMeshWake);
+	MeshComp->OnComponentSleep.AddDynamic(this, &ASExplosiveBarrel::OnMeshSleep);
 	RootComponent = MeshComp;
 
 	RadialForceComp = CreateDefaultSubobject<URadialForceComponent>(TEXT("RadialForceComp"));
@@ -30,6 +35,8 @@ ASExplosiveBarrel::ASExplosiveBarrel()
 
 	SetReplicates(true);
 	SetReplicateMovement(true);
+	// Woken up by physics or the explosion, see OnMeshWake
+	NetDormancy = DORM_DormantAll;
 }
 
 
@@ -45,6 +52,7 @@ void ASExplosiveBarrel::OnHealthChanged(USHealthComponent* OwningHealthComp, flo
 	if (Health <= 0.0f)
 	{
 		// Explode!
+		FlushNetDormancy();
 		bExploded = true;
 		OnRep_Exploded();
 
@@ -55,6 +63,8 @@ void ASExplosiveBarrel::OnHealthChanged(USHealthComponent* OwningHealthComp, flo
 		// Blast away nearby physics actors
 		RadialForceComp->FireImpulse();
 
+		FSCombatTelemetry::Record(ESTelemetryEvent::Explosion, this, DamageCauser, 0.0f, RadialForceComp->Radius);
+
 		// @TODO: Apply radial damage
 	}
 }
@@ -62,13 +72,39 @@ void ASExplosiveBarrel::OnHealthChanged(USHealthComponent* OwningHealthComp, flo
 
 void ASExplosiveBarrel::OnRep_Exploded()
 {
+	// Called by hand on the server, where there is nobody to show it to
+	if (IsNetMode(NM_DedicatedServer))
+	{
+		return;
+	}
+
 	// Play FX and change self material to black
-	UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ExplosionEffect, GetActorLocation());
+	ASFXBudget::RequestEmitterAtLocation(this, ExplosionEffect, ESFXCategory::Explosion, GetActorLocation());
 	// Override material on mesh with blackened version
 	MeshComp->SetMaterial(0, ExplodedMaterial);
 }
 
 
+void ASExplosiveBarrel::OnMeshWake(UPrimitiveComponent* WakingComponent, FName BoneName)
+{
+	if (Role == ROLE_Authority)
+	{
+		SetNetDormancy(DORM_Awake);
+	}
+}
+
+
+void ASExplosiveBarrel::OnMeshSleep(UPrimitiveComponent* SleepingComponent, FName BoneName)
+{
+	if (Role == ROLE_Authority)
+	{
+		// Send the resting transform, then stop considering the barrel until something wakes it again
+		ForceNetUpdate();
+		SetNetDormancy(DORM_DormantAll);
+	}
+}
+
+
 void ASExplosiveBarrel::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SDamageQueue.h"
+#include "SHealthComponent.h"
+
+static int32 CoalesceDamage = 1;
+FAutoConsoleVariableRef CVARCoalesceDamage(
+	TEXT("COOP.CoalesceDamage"),
+	CoalesceDamage,
+	TEXT("Apply all damage an actor takes during a frame in a single health update"),
+	ECVF_Default);
+
+// Damage causing more damage (bots blowing up bots) is applied in the same frame up to this many times
+static const int32 MaxFlushPasses = 8;
+
+
+ASDamageQueue::ASDamageQueue()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	// After timers and physics, so shots and explosions of this frame are all in
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+}
+
+
+bool ASDamageQueue::IsEnabled()
+{
+	return CoalesceDamage > 0;
+}
+
+
+void ASDamageQueue::Enqueue(USHealthComponent* HealthComp)
+{
+	QueuedComponents.Add(HealthComp);
+
+	if (!IsActorTickEnabled())
+	{
+		SetActorTickEnabled(true);
+	}
+}
+
+
+void ASDamageQueue::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	Flush();
+
+	if (QueuedComponents.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+
+void ASDamageQueue::Flush()
+{
+	for (int32 Pass = 0; Pass < MaxFlushPasses && QueuedComponents.Num() > 0; Pass++)
+	{
+		// Anything queued while applying goes into the next pass
+		Swap(ComponentsToApply, QueuedComponents);
+
+		for (const TWeakObjectPtr<USHealthComponent>& HealthComp : ComponentsToApply)
+		{
+			if (HealthComp.IsValid())
+			{
+				HealthComp->ApplyQueuedDamage();
+			}
+		}
+
+		ComponentsToApply.Reset();
+	}
+}
@@ -2,9 +2,76 @@
 
 #include "SHealthComponent.h"
 #include "SGameMode.h"
+#include "STeamRegistry.h"
+#include "SCombatTelemetry.h"
+#include "SDamageQueue.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
 #include "Net/UnrealNetwork.h"
 
 
+// Compares IsFriendly through the team registry against the old component search on all actors with health
+static void BenchmarkIsFriendly(const TArray<FString>& Args, UWorld* World)
+{
+	int32 Iterations = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100;
+
+	TArray<AActor*> Actors;
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		if (USHealthComponent::FindHealthComponent(*It))
+		{
+			Actors.Add(*It);
+		}
+	}
+
+	if (Actors.Num() < 2 || Iterations <= 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("COOP.BenchIsFriendly: Need at least two actors with a health component"));
+		return;
+	}
+
+	int32 NrOfFriendly = 0;
+
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < Iterations; i++)
+	{
+		for (AActor* ActorA : Actors)
+		{
+			for (AActor* ActorB : Actors)
+			{
+				USHealthComponent* HealthCompA = Cast<USHealthComponent>(ActorA->GetComponentByClass(USHealthComponent::StaticClass()));
+				USHealthComponent* HealthCompB = Cast<USHealthComponent>(ActorB->GetComponentByClass(USHealthComponent::StaticClass()));
+				NrOfFriendly += (HealthCompA->TeamNum == HealthCompB->TeamNum) ? 1 : 0;
+			}
+		}
+	}
+	double ComponentSearchTime = FPlatformTime::Seconds() - StartTime;
+
+	StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < Iterations; i++)
+	{
+		for (AActor* ActorA : Actors)
+		{
+			for (AActor* ActorB : Actors)
+			{
+				NrOfFriendly += USHealthComponent::IsFriendly(ActorA, ActorB) ? 1 : 0;
+			}
+		}
+	}
+	double RegistryTime = FPlatformTime::Seconds() - StartTime;
+
+	double NrOfCalls = (double)Iterations * Actors.Num() * Actors.Num();
+
+	UE_LOG(LogTemp, Log, TEXT("COOP.BenchIsFriendly: %d actors, %.0f calls. Component search: %.1f ns/call, Team registry: %.1f ns/call (%d)"),
+		Actors.Num(), NrOfCalls, ComponentSearchTime * 1e9 / NrOfCalls, RegistryTime * 1e9 / NrOfCalls, NrOfFriendly);
+}
+
+FAutoConsoleCommandWithWorldAndArgs CCmdBenchmarkIsFriendly(
+	TEXT("COOP.BenchIsFriendly"),
+	TEXT("Measure IsFriendly against the old GetComponentByClass lookup. Args: [Iterations]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchmarkIsFriendly));
+
+
 // Sets default values for this component's properties
 USHealthComponent::USHealthComponent()
 {
@@ -33,6 +100,37 @@ void USHealthComponent::BeginPlay()
 	}
 
 	Health = DefaultHealth;
+
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		FSCombatTelemetry::Record(ESTelemetryEvent::Spawn, GetOwner(), nullptr, Health);
+	}
+}
+
+
+void USHealthComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	//Only gameplay asks who is friendly, editor and preview worlds stay out of the registry
+	AActor* MyOwner = GetOwner();
+	UWorld* World = GetWorld();
+	if (MyOwner && World && World->IsGameWorld())
+	{
+		FSTeamRegistry::Register(MyOwner, this);
+	}
+}
+
+
+void USHealthComponent::OnUnregister()
+{
+	AActor* MyOwner = GetOwner();
+	if (MyOwner)
+	{
+		FSTeamRegistry::Unregister(MyOwner, this);
+	}
+
+	Super::OnUnregister();
 }
 
 
@@ -57,21 +155,83 @@ void USHealthComponent::HandleTakeAnyDamage(AActor* DamagedActor, float Damage,
 		return;
 	}
 
-	// Update health clamped
-	Health = FMath::Clamp(Health - Damage, 0.0f, DefaultHealth);
+	FSQueuedDamage Hit;
+	Hit.Damage = Damage;
+	Hit.DamageType = DamageType;
+	Hit.InstigatedBy = InstigatedBy;
+	Hit.DamageCauser = DamageCauser;
+
+	// Coalesce all hits of this frame, the damage queue applies them at the end of the frame
+	ASDamageQueue* DamageQueue = ASDamageQueue::IsEnabled() ? ASWorldManager::Get<ASDamageQueue>(this) : nullptr;
+	if (DamageQueue)
+	{
+		if (QueuedDamage.Num() == 0)
+		{
+			DamageQueue->Enqueue(this);
+		}
+
+		QueuedDamage.Add(Hit);
+		return;
+	}
+
+	QueuedDamage.Add(Hit);
+	ApplyQueuedDamage();
+}
+
+
+void USHealthComponent::ApplyQueuedDamage()
+{
+	if (QueuedDamage.Num() == 0)
+	{
+		return;
+	}
+
+	if (bIsDead)
+	{
+		QueuedDamage.Reset();
+		return;
+	}
+
+	float NewHealth = Health;
+	float TotalDamage = 0.0f;
+	int32 LastHitIndex = 0;
+
+	// Apply hits in the order they arrived, the hit that takes us to zero gets the kill credit
+	for (int32 i = 0; i < QueuedDamage.Num(); i++)
+	{
+		const FSQueuedDamage& QueuedHit = QueuedDamage[i];
+
+		// Update health clamped
+		NewHealth = FMath::Clamp(NewHealth - QueuedHit.Damage, 0.0f, DefaultHealth);
+		TotalDamage += QueuedHit.Damage;
+		LastHitIndex = i;
+
+		FSCombatTelemetry::Record(ESTelemetryEvent::Damage, GetOwner(), QueuedHit.DamageCauser.Get(), QueuedHit.Damage, NewHealth);
+
+		if (NewHealth <= 0.0f)
+		{
+			break;
+		}
+	}
 
-	UE_LOG(LogTemp, Log, TEXT("Health Changed: %s"), *FString::SanitizeFloat(Health));
+	// Copy, broadcasting may queue more damage on us
+	const FSQueuedDamage Hit = QueuedDamage[LastHitIndex];
+	QueuedDamage.Reset();
+
+	Health = NewHealth;
 
 	bIsDead = Health <= 0.0f;
 
-	OnHealthChanged.Broadcast(this, Health, Damage, DamageType, InstigatedBy, DamageCauser);
+	OnHealthChanged.Broadcast(this, Health, TotalDamage, Hit.DamageType, Hit.InstigatedBy.Get(), Hit.DamageCauser.Get());
 
 	if (bIsDead)
 	{
+		FSCombatTelemetry::Record(ESTelemetryEvent::Kill, GetOwner(), Hit.DamageCauser.Get(), Hit.Damage);
+
 		ASGameMode* GM = Cast<ASGameMode>(GetWorld()->GetAuthGameMode());
 		if (GM)
 		{
-			GM->OnActorKilled.Broadcast(GetOwner(), DamageCauser, InstigatedBy);
+			GM->OnActorKilled.Broadcast(GetOwner(), Hit.DamageCauser.Get(), Hit.InstigatedBy.Get());
 		}
 	}
 }
@@ -86,7 +246,7 @@ void USHealthComponent::Heal(float HealAmount)
 
 	Health = FMath::Clamp(Health + HealAmount, 0.0f, DefaultHealth);
 
-	UE_LOG(LogTemp, Log, TEXT("Health Changed: %s (+%s)"), *FString::SanitizeFloat(Health), *FString::SanitizeFloat(HealAmount));
+	FSCombatTelemetry::Record(ESTelemetryEvent::Heal, GetOwner(), nullptr, HealAmount, Health);
 
 	OnHealthChanged.Broadcast(this, Health, -HealAmount, nullptr, nullptr, nullptr);
 }
@@ -100,8 +260,8 @@ bool USHealthComponent::IsFriendly(AActor* ActorA, AActor* ActorB)
 		return true;
 	}
 
-	USHealthComponent* HealthCompA = Cast<USHealthComponent>(ActorA->GetComponentByClass(USHealthComponent::StaticClass()));
-	USHealthComponent* HealthCompB = Cast<USHealthComponent>(ActorB->GetComponentByClass(USHealthComponent::StaticClass()));
+	USHealthComponent* HealthCompA = FSTeamRegistry::FindHealthComponent(ActorA);
+	USHealthComponent* HealthCompB = FSTeamRegistry::FindHealthComponent(ActorB);
 
 	if (HealthCompA == nullptr || HealthCompB == nullptr)
 	{
@@ -109,7 +269,19 @@ bool USHealthComponent::IsFriendly(AActor* ActorA, AActor* ActorB)
 		return true;
 	}
 
-	return HealthCompA->TeamNum == HealthCompB->TeamNum;
+	return FSTeamRegistry::AreTeamsFriendly(HealthCompA->TeamNum, HealthCompB->TeamNum);
+}
+
+
+void USHealthComponent::SetTeamsFriendly(uint8 TeamA, uint8 TeamB, bool bFriendly)
+{
+	FSTeamRegistry::SetTeamsFriendly(TeamA, TeamB, bFriendly);
+}
+
+
+USHealthComponent* USHealthComponent::FindHealthComponent(const AActor* Actor)
+{
+	return Actor ? FSTeamRegistry::FindHealthComponent(Actor) : nullptr;
 }
 
 
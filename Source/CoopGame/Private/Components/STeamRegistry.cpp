@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "STeamRegistry.h"
+#include "Engine/World.h"
+
+
+TArray<USHealthComponent*> FSTeamRegistry::HealthComponents;
+
+int32 FSTeamRegistry::NumRegistered = 0;
+
+FDelegateHandle FSTeamRegistry::WorldCleanupHandle;
+
+FSTeamRegistry::FTeamMatrix FSTeamRegistry::FriendlyMatrix;
+
+
+FSTeamRegistry::FTeamMatrix::FTeamMatrix()
+{
+	FMemory::Memzero(Bits);
+
+	// Every team is friendly with itself
+	for (int32 Team = 0; Team < 256; Team++)
+	{
+		Bits[Team][Team >> 5] |= 1u << (Team & 31);
+	}
+}
+
+
+void FSTeamRegistry::Register(const AActor* Actor, USHealthComponent* HealthComp)
+{
+	check(IsInGameThread());
+
+	if (!WorldCleanupHandle.IsValid())
+	{
+		WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddStatic(&FSTeamRegistry::OnWorldCleanup);
+	}
+
+	const int32 Index = Actor->GetUniqueID();
+	if (Index >= HealthComponents.Num())
+	{
+		HealthComponents.AddZeroed(Index + 1 - HealthComponents.Num());
+	}
+
+	NumRegistered += HealthComponents[Index] == nullptr ? 1 : 0;
+	HealthComponents[Index] = HealthComp;
+}
+
+
+void FSTeamRegistry::Unregister(const AActor* Actor, USHealthComponent* HealthComp)
+{
+	check(IsInGameThread());
+
+	// Only clear the slot if it is still ours (the object index may be reused by now)
+	const int32 Index = Actor->GetUniqueID();
+	if (HealthComponents.IsValidIndex(Index) && HealthComponents[Index] == HealthComp)
+	{
+		HealthComponents[Index] = nullptr;
+
+		// Last one out, the table grew to the highest object index we saw and is not needed until the next session
+		if (--NumRegistered == 0)
+		{
+			HealthComponents.Empty();
+		}
+	}
+}
+
+
+void FSTeamRegistry::SetTeamsFriendly(uint8 TeamA, uint8 TeamB, bool bFriendly)
+{
+	if (bFriendly)
+	{
+		FriendlyMatrix.Bits[TeamA][TeamB >> 5] |= 1u << (TeamB & 31);
+		FriendlyMatrix.Bits[TeamB][TeamA >> 5] |= 1u << (TeamA & 31);
+	}
+	else
+	{
+		FriendlyMatrix.Bits[TeamA][TeamB >> 5] &= ~(1u << (TeamB & 31));
+		FriendlyMatrix.Bits[TeamB][TeamA >> 5] &= ~(1u << (TeamA & 31));
+	}
+}
+
+
+void FSTeamRegistry::OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+{
+	// Relationships were set up for the match that just ended
+	if (World && World->IsGameWorld())
+	{
+		FriendlyMatrix = FTeamMatrix();
+	}
+}
@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SLoadTestActorChannel.h"
+#include "SLoadTestReporter.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Net/DataBunch.h"
+
+
+USLoadTestActorChannel::USLoadTestActorChannel(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+}
+
+
+FPacketIdRange USLoadTestActorChannel::SendBunch(FOutBunch* Bunch, bool Merge)
+{
+	// Channels are pooled and reused, the reporter is looked up once per channel
+	if (!Reporter.IsValid() && Connection && Connection->Driver)
+	{
+		Reporter = ASWorldManager::Get<ASLoadTestReporter>(Connection->Driver->GetWorld(), false);
+	}
+
+	if (Reporter.IsValid() && Actor && Bunch)
+	{
+		Reporter->AddReplicationCost(Actor->GetClass(), Bunch->GetNumBits());
+	}
+
+	return Super::SendBunch(Bunch, Merge);
+}
@@ -0,0 +1,173 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SLoadTestBot.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+#include "Misc/CommandLine.h"
+
+
+ASLoadTestBot::ASLoadTestBot()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	// Input has to be in before the player controller and pawn tick
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	PhaseTimeRemaining = 0.0f;
+	bFirePhase = false;
+	BurstTimeRemaining = 0.0f;
+}
+
+
+void ASLoadTestBot::StartFromCommandLine(const UObject* WorldContextObject)
+{
+	if (!FParse::Param(FCommandLine::Get(), TEXT("LoadTestBot")))
+	{
+		return;
+	}
+
+	ASLoadTestBot* Bot = ASWorldManager::Get<ASLoadTestBot>(WorldContextObject);
+	if (Bot && Bot->GetNetMode() == NM_Client)
+	{
+		int32 Seed = FPlatformProcess::GetCurrentProcessId();
+		FParse::Value(FCommandLine::Get(), TEXT("LoadTestSeed="), Seed);
+
+		Bot->RandomStream.Initialize(Seed);
+		Bot->SetActorTickEnabled(true);
+
+		UE_LOG(LogTemp, Log, TEXT("Load test bot started (seed %d)"), Seed);
+	}
+}
+
+
+void ASLoadTestBot::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	APlayerController* PC = GetWorld()->GetFirstPlayerController();
+	if (PC == nullptr || PC->PlayerInput == nullptr)
+	{
+		return;
+	}
+
+	PhaseTimeRemaining -= DeltaSeconds;
+	if (PhaseTimeRemaining <= 0.0f)
+	{
+		StartNextPhase();
+	}
+
+	// Hold exactly the keys of this phase
+	for (int32 i = PressedKeys.Num() - 1; i >= 0; i--)
+	{
+		if (!PhaseKeys.Contains(PressedKeys[i]) && PressedKeys[i] != EKeys::LeftMouseButton)
+		{
+			SetKeyDown(PC, PressedKeys[i], false);
+		}
+	}
+
+	for (const FKey& Key : PhaseKeys)
+	{
+		SetKeyDown(PC, Key, true);
+	}
+
+	// Fire in bursts, the weapon keeps its own fire rate while the button is held
+	BurstTimeRemaining -= DeltaSeconds;
+	if (BurstTimeRemaining <= 0.0f)
+	{
+		const bool bFiring = PressedKeys.Contains(EKeys::LeftMouseButton);
+		SetKeyDown(PC, EKeys::LeftMouseButton, bFirePhase && !bFiring);
+
+		BurstTimeRemaining = bFiring ? RandomStream.FRandRange(0.2f, 0.6f) : RandomStream.FRandRange(0.1f, 1.5f);
+	}
+
+	PC->InputAxis(EKeys::MouseX, LookRate.X * DeltaSeconds, DeltaSeconds, 1, false);
+	PC->InputAxis(EKeys::MouseY, LookRate.Y * DeltaSeconds, DeltaSeconds, 1, false);
+}
+
+
+void ASLoadTestBot::StartNextPhase()
+{
+	PhaseTimeRemaining = RandomStream.FRandRange(1.0f, 4.0f);
+
+	PhaseKeys.Reset();
+
+	// Walk in one of eight directions (or stand still now and then)
+	static const FKey* MoveKeys[][2] =
+	{
+		{ &EKeys::W, nullptr }, { &EKeys::W, &EKeys::D }, { &EKeys::D, nullptr }, { &EKeys::S, &EKeys::D },
+		{ &EKeys::S, nullptr }, { &EKeys::S, &EKeys::A }, { &EKeys::A, nullptr }, { &EKeys::W, &EKeys::A },
+	};
+
+	const int32 Direction = RandomStream.RandRange(0, ARRAY_COUNT(MoveKeys));
+	if (Direction < ARRAY_COUNT(MoveKeys))
+	{
+		PhaseKeys.Add(*MoveKeys[Direction][0]);
+		if (MoveKeys[Direction][1])
+		{
+			PhaseKeys.Add(*MoveKeys[Direction][1]);
+		}
+	}
+
+	const bool bSprint = RandomStream.FRand() < 0.3f;
+	if (bSprint)
+	{
+		PhaseKeys.Add(EKeys::LeftShift);
+	}
+
+	// No aiming or firing while sprinting
+	const bool bAim = !bSprint && RandomStream.FRand() < 0.4f;
+	if (bAim)
+	{
+		PhaseKeys.Add(EKeys::RightMouseButton);
+	}
+
+	bFirePhase = !bSprint && RandomStream.FRand() < 0.6f;
+
+	LookRate.X = RandomStream.FRandRange(-60.0f, 60.0f);
+	LookRate.Y = RandomStream.FRandRange(-5.0f, 5.0f);
+}
+
+
+void ASLoadTestBot::SetKeyDown(APlayerController* PC, const FKey& Key, bool bDown)
+{
+	const bool bIsDown = PressedKeys.Contains(Key);
+	if (bDown == bIsDown)
+	{
+		return;
+	}
+
+	PC->InputKey(Key, bDown ? IE_Pressed : IE_Released, bDown ? 1.0f : 0.0f, false);
+
+	if (bDown)
+	{
+		PressedKeys.Add(Key);
+	}
+	else
+	{
+		PressedKeys.Remove(Key);
+	}
+}
+
+
+void ASLoadTestBot::ReleaseAllKeys()
+{
+	APlayerController* PC = GetWorld() ? GetWorld()->GetFirstPlayerController() : nullptr;
+	if (PC && PC->PlayerInput)
+	{
+		TArray<FKey> KeysToRelease = PressedKeys;
+		for (const FKey& Key : KeysToRelease)
+		{
+			SetKeyDown(PC, Key, false);
+		}
+	}
+
+	PressedKeys.Reset();
+}
+
+
+void ASLoadTestBot::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ReleaseAllKeys();
+
+	Super::EndPlay(EndPlayReason);
+}
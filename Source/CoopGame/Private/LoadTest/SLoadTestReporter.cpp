@@ -0,0 +1,410 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SLoadTestReporter.h"
+#include "SLoadTestActorChannel.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "EngineUtils.h"
+#include "UObject/UObjectIterator.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Components/AudioComponent.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+static const float FrameTimeBucketMs = 0.5f;
+static const int32 NumFrameTimeBuckets = 201;
+
+
+ASLoadTestReporter::ASLoadTestReporter()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
+	TotalTickTime = 0.0;
+	MaxTickTime = 0.0f;
+	NumFrames = 0;
+	NumSamples = 0;
+	PeakNumConnections = 0;
+	BaseParticleComponents = 0;
+	BaseAudioComponents = 0;
+	BaseDynamicMaterials = 0;
+	PeakParticleComponents = 0;
+	PeakAudioComponents = 0;
+	PeakDynamicMaterials = 0;
+	SampleTimeRemaining = 1.0f;
+	TestTimeRemaining = 0.0f;
+	TestDuration = 120.0f;
+	bMeasuring = false;
+	bReportWritten = false;
+}
+
+
+void ASLoadTestReporter::StartFromCommandLine(const UObject* WorldContextObject)
+{
+	if (!FParse::Param(FCommandLine::Get(), TEXT("LoadTest")))
+	{
+		return;
+	}
+
+	ASLoadTestReporter* Reporter = ASWorldManager::Get<ASLoadTestReporter>(WorldContextObject);
+	if (Reporter && Reporter->GetNetMode() != NM_Client)
+	{
+		Reporter->StartMeasuring();
+	}
+}
+
+
+void ASLoadTestReporter::StartMeasuring()
+{
+	if (bMeasuring)
+	{
+		return;
+	}
+
+	FParse::Value(FCommandLine::Get(), TEXT("LoadTestDuration="), TestDuration);
+	TestTimeRemaining = TestDuration;
+
+	if (!FParse::Value(FCommandLine::Get(), TEXT("LoadTestReport="), ReportFilename))
+	{
+		ReportFilename = FPaths::ProjectSavedDir() / TEXT("LoadTest") / FString::Printf(TEXT("LoadTest-%s.txt"), *FDateTime::Now().ToString());
+	}
+
+	FrameTimeHistogram.SetNumZeroed(NumFrameTimeBuckets);
+	GameThreadTimeHistogram.SetNumZeroed(NumFrameTimeBuckets);
+
+	CountCosmetics(BaseParticleComponents, BaseAudioComponents, BaseDynamicMaterials);
+
+	// Actor channels opened from here on count what they send per class
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	FChannelDefinition* ActorChannelDefinition = NetDriver ? NetDriver->ChannelDefinitionMap.Find(NAME_Actor) : nullptr;
+	if (ActorChannelDefinition)
+	{
+		ActorChannelDefinition->ChannelClass = USLoadTestActorChannel::StaticClass();
+	}
+
+	// Per property bit costs, written to Saved/Profiling for the NetworkProfiler tool
+	GEngine->Exec(GetWorld(), TEXT("netprofile enable"));
+
+	bMeasuring = true;
+	SetActorTickEnabled(true);
+
+	UE_LOG(LogTemp, Log, TEXT("Load test measuring for %.0f seconds, report will be written to %s"), TestDuration, *ReportFilename);
+}
+
+
+void ASLoadTestReporter::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (!bMeasuring)
+	{
+		return;
+	}
+
+	// Frame time includes waiting for the server tick rate, tick time is what the server actually spent working
+	const double FrameTime = FApp::GetDeltaTime();
+	const double TickTime = FMath::Max(FrameTime - FApp::GetIdleTime(), 0.0);
+
+	FrameTimeHistogram[FMath::Min((int32)(FrameTime * 1000.0 / FrameTimeBucketMs), NumFrameTimeBuckets - 1)]++;
+	GameThreadTimeHistogram[FMath::Min((int32)(TickTime * 1000.0 / FrameTimeBucketMs), NumFrameTimeBuckets - 1)]++;
+
+	TotalTickTime += TickTime;
+	MaxTickTime = FMath::Max(MaxTickTime, (float)TickTime * 1000.0f);
+	NumFrames++;
+
+	SampleTimeRemaining -= DeltaSeconds;
+	if (SampleTimeRemaining <= 0.0f)
+	{
+		// Connection rates are updated once per second by the engine
+		SampleTimeRemaining += 1.0f;
+
+		SampleConnections();
+		SampleClasses();
+		SampleCosmetics();
+		NumSamples++;
+	}
+
+	TestTimeRemaining -= DeltaSeconds;
+	if (TestTimeRemaining <= 0.0f)
+	{
+		WriteReport();
+
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+
+void ASLoadTestReporter::SampleConnections()
+{
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (NetDriver == nullptr)
+	{
+		return;
+	}
+
+	PeakNumConnections = FMath::Max(PeakNumConnections, NetDriver->ClientConnections.Num());
+
+	// Move closed connections out of the map before their pointers can be reused
+	for (auto It = ConnectionStats.CreateIterator(); It; ++It)
+	{
+		if (!NetDriver->ClientConnections.Contains(It.Key()))
+		{
+			ClosedConnectionStats.Add(It.Value());
+			It.RemoveCurrent();
+		}
+	}
+
+	for (UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (Connection == nullptr)
+		{
+			continue;
+		}
+
+		FSLoadTestConnectionStats& Stats = ConnectionStats.FindOrAdd(Connection);
+		if (Stats.NumSamples == 0)
+		{
+			Stats.Address = Connection->LowLevelGetRemoteAddress(true);
+		}
+
+		if (Stats.PlayerName.IsEmpty() && Connection->PlayerController && Connection->PlayerController->PlayerState)
+		{
+			Stats.PlayerName = Connection->PlayerController->PlayerState->GetPlayerName();
+		}
+
+		Stats.TotalInBytes += Connection->InBytesPerSecond;
+		Stats.TotalOutBytes += Connection->OutBytesPerSecond;
+		Stats.PeakInBytesPerSecond = FMath::Max(Stats.PeakInBytesPerSecond, Connection->InBytesPerSecond);
+		Stats.PeakOutBytesPerSecond = FMath::Max(Stats.PeakOutBytesPerSecond, Connection->OutBytesPerSecond);
+		Stats.TotalPing += Connection->AvgLag * 1000.0;
+		Stats.TotalPacketsLost += Connection->InPacketsLost;
+		Stats.NumSamples++;
+	}
+}
+
+
+void ASLoadTestReporter::SampleClasses()
+{
+	TMap<FName, int32> Counts;
+	TMap<FName, float> Frequencies;
+
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		AActor* Actor = *It;
+		if (Actor->GetIsReplicated() && !Actor->IsPendingKill())
+		{
+			const FName ClassName = Actor->GetClass()->GetFName();
+			Counts.FindOrAdd(ClassName)++;
+			Frequencies.Add(ClassName, Actor->NetUpdateFrequency);
+		}
+	}
+
+	for (const TPair<FName, int32>& Count : Counts)
+	{
+		FSLoadTestClassStats& Stats = ClassStats.FindOrAdd(Count.Key);
+		Stats.PeakCount = FMath::Max(Stats.PeakCount, Count.Value);
+		Stats.TotalCount += Count.Value;
+		Stats.NetUpdateFrequency = Frequencies[Count.Key];
+	}
+}
+
+
+void ASLoadTestReporter::AddReplicationCost(const UClass* ActorClass, int64 NumBits)
+{
+	if (!bMeasuring || bReportWritten)
+	{
+		return;
+	}
+
+	FSLoadTestClassStats& Stats = ClassStats.FindOrAdd(ActorClass->GetFName());
+	Stats.TotalBits += NumBits;
+	Stats.NumBunches++;
+}
+
+
+void ASLoadTestReporter::SampleCosmetics()
+{
+	int32 NumParticleComponents;
+	int32 NumAudioComponents;
+	int32 NumDynamicMaterials;
+	CountCosmetics(NumParticleComponents, NumAudioComponents, NumDynamicMaterials);
+
+	PeakParticleComponents = FMath::Max(PeakParticleComponents, NumParticleComponents - BaseParticleComponents);
+	PeakAudioComponents = FMath::Max(PeakAudioComponents, NumAudioComponents - BaseAudioComponents);
+	PeakDynamicMaterials = FMath::Max(PeakDynamicMaterials, NumDynamicMaterials - BaseDynamicMaterials);
+}
+
+
+void ASLoadTestReporter::CountCosmetics(int32& OutParticleComponents, int32& OutAudioComponents, int32& OutDynamicMaterials) const
+{
+	UWorld* World = GetWorld();
+
+	OutParticleComponents = 0;
+	for (TObjectIterator<UParticleSystemComponent> It; It; ++It)
+	{
+		OutParticleComponents += !It->IsTemplate() && It->GetWorld() == World ? 1 : 0;
+	}
+
+	OutAudioComponents = 0;
+	for (TObjectIterator<UAudioComponent> It; It; ++It)
+	{
+		OutAudioComponents += !It->IsTemplate() && It->GetWorld() == World ? 1 : 0;
+	}
+
+	OutDynamicMaterials = 0;
+	for (TObjectIterator<UMaterialInstanceDynamic> It; It; ++It)
+	{
+		OutDynamicMaterials += It->GetWorld() == World ? 1 : 0;
+	}
+}
+
+
+float ASLoadTestReporter::GetFrameTimePercentile(const TArray<int32>& Histogram, float Percentile) const
+{
+	int32 NumInHistogram = 0;
+	for (int32 Count : Histogram)
+	{
+		NumInHistogram += Count;
+	}
+
+	const int32 Target = FMath::CeilToInt(NumInHistogram * Percentile);
+
+	int32 Accumulated = 0;
+	for (int32 i = 0; i < Histogram.Num(); i++)
+	{
+		Accumulated += Histogram[i];
+		if (Accumulated >= Target && Accumulated > 0)
+		{
+			// Upper edge of the bucket
+			return (i + 1) * FrameTimeBucketMs;
+		}
+	}
+
+	return 0.0f;
+}
+
+
+void ASLoadTestReporter::WriteReport()
+{
+	if (bReportWritten || !bMeasuring)
+	{
+		return;
+	}
+
+	bReportWritten = true;
+
+	GEngine->Exec(GetWorld(), TEXT("netprofile disable"));
+
+	const float MeasuredSeconds = FMath::Max(TestDuration - FMath::Max(TestTimeRemaining, 0.0f), 1.0f);
+
+	FString Report;
+	Report += FString::Printf(TEXT("Load test report - %s\n"), *FDateTime::Now().ToString());
+	Report += FString::Printf(TEXT("Map: %s, duration: %.0fs, peak connections: %d\n\n"), *GetWorld()->GetMapName(), MeasuredSeconds, PeakNumConnections);
+
+	// ------- SERVER TICK ------- \\
+
+	Report += TEXT("[Server tick]\n");
+	Report += FString::Printf(TEXT("Frames: %d, average tick: %.2fms, max tick: %.2fms\n"), NumFrames, NumFrames > 0 ? TotalTickTime * 1000.0 / NumFrames : 0.0, MaxTickTime);
+	Report += FString::Printf(TEXT("Tick p50/p95/p99: %.1f / %.1f / %.1f ms\n"),
+		GetFrameTimePercentile(GameThreadTimeHistogram, 0.5f), GetFrameTimePercentile(GameThreadTimeHistogram, 0.95f), GetFrameTimePercentile(GameThreadTimeHistogram, 0.99f));
+	Report += FString::Printf(TEXT("Frame p50/p95/p99: %.1f / %.1f / %.1f ms (includes waiting for the server tick rate)\n\n"),
+		GetFrameTimePercentile(FrameTimeHistogram, 0.5f), GetFrameTimePercentile(FrameTimeHistogram, 0.95f), GetFrameTimePercentile(FrameTimeHistogram, 0.99f));
+
+	// ------- CONNECTIONS ------- \\
+
+	TArray<FSLoadTestConnectionStats> AllConnections = ClosedConnectionStats;
+	for (const TPair<UNetConnection*, FSLoadTestConnectionStats>& Pair : ConnectionStats)
+	{
+		AllConnections.Add(Pair.Value);
+	}
+
+	int64 TotalIn = 0;
+	int64 TotalOut = 0;
+
+	Report += TEXT("[Connections]\n");
+	Report += TEXT("Address,Player,Seconds,BytesIn,BytesOut,AvgInBps,AvgOutBps,PeakInBps,PeakOutBps,AvgPingMs,PacketsLost\n");
+	for (const FSLoadTestConnectionStats& Stats : AllConnections)
+	{
+		const int32 Seconds = FMath::Max(Stats.NumSamples, 1);
+		Report += FString::Printf(TEXT("%s,%s,%d,%lld,%lld,%lld,%lld,%d,%d,%.1f,%d\n"), *Stats.Address, *Stats.PlayerName, Stats.NumSamples,
+			Stats.TotalInBytes, Stats.TotalOutBytes, Stats.TotalInBytes / Seconds, Stats.TotalOutBytes / Seconds,
+			Stats.PeakInBytesPerSecond, Stats.PeakOutBytesPerSecond, Stats.TotalPing / Seconds, Stats.TotalPacketsLost);
+
+		TotalIn += Stats.TotalInBytes;
+		TotalOut += Stats.TotalOutBytes;
+	}
+
+	Report += FString::Printf(TEXT("Total in: %lld bytes (%.0f B/s), total out: %lld bytes (%.0f B/s)\n\n"),
+		TotalIn, TotalIn / MeasuredSeconds, TotalOut, TotalOut / MeasuredSeconds);
+
+	// ------- CLASSES ------- \\
+
+	// Most expensive first
+	ClassStats.ValueSort([](const FSLoadTestClassStats& A, const FSLoadTestClassStats& B)
+	{
+		return A.TotalBits != B.TotalBits ? A.TotalBits > B.TotalBits : A.TotalCount > B.TotalCount;
+	});
+
+	int64 TotalClassBits = 0;
+	for (const TPair<FName, FSLoadTestClassStats>& Pair : ClassStats)
+	{
+		TotalClassBits += Pair.Value.TotalBits;
+	}
+
+	Report += TEXT("[Replicated classes]\n");
+	Report += TEXT("Class,AvgCount,PeakCount,NetUpdateFrequency,Bunches,BytesSent,AvgBps,AvgBpsPerActor,ShareOfActorTraffic\n");
+	for (const TPair<FName, FSLoadTestClassStats>& Pair : ClassStats)
+	{
+		const FSLoadTestClassStats& Stats = Pair.Value;
+		const float AvgCount = (float)Stats.TotalCount / FMath::Max(NumSamples, 1);
+		const float BytesPerSecond = Stats.TotalBits / 8.0f / MeasuredSeconds;
+
+		Report += FString::Printf(TEXT("%s,%.1f,%d,%.0f,%d,%lld,%.0f,%.1f,%.1f%%\n"), *Pair.Key.ToString(), AvgCount, Stats.PeakCount, Stats.NetUpdateFrequency,
+			Stats.NumBunches, Stats.TotalBits / 8, BytesPerSecond, AvgCount > 0.0f ? BytesPerSecond / AvgCount : 0.0f,
+			TotalClassBits > 0 ? Stats.TotalBits * 100.0 / TotalClassBits : 0.0);
+	}
+
+	// ------- COSMETICS ------- \\
+
+	Report += TEXT("\n[Cosmetics]\n");
+	Report += FString::Printf(TEXT("Created during the test (peak) - particle components: %d, audio components: %d, dynamic materials: %d\n"), PeakParticleComponents, PeakAudioComponents, PeakDynamicMaterials);
+
+	if (IsNetMode(NM_DedicatedServer))
+	{
+		const bool bPassed = PeakParticleComponents == 0 && PeakAudioComponents == 0 && PeakDynamicMaterials == 0;
+		Report += FString::Printf(TEXT("Dedicated server cosmetics check: %s\n"), bPassed ? TEXT("PASSED") : TEXT("FAILED"));
+
+		if (!bPassed)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Dedicated server created cosmetic objects during the load test, see the [Cosmetics] section of the report"));
+		}
+	}
+
+	Report += TEXT("\nReplication cost per property: open the .nprof capture in Saved/Profiling with the NetworkProfiler tool.\n");
+
+	if (FFileHelper::SaveStringToFile(Report, *ReportFilename))
+	{
+		UE_LOG(LogTemp, Log, TEXT("Load test report written to %s"), *ReportFilename);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to write load test report to %s"), *ReportFilename);
+	}
+}
+
+
+void ASLoadTestReporter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Server shut down or changed map before the test ran out, report what we have
+	WriteReport();
+
+	Super::EndPlay(EndPlayReason);
+}
@@ -0,0 +1,514 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SLagCompensation.h"
+#include "CoopGame.h"
+#include "GameFramework/Pawn.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+
+static int32 LagCompensationEnabled = 1;
+FAutoConsoleVariableRef CVARLagCompensationEnabled(
+	TEXT("COOP.LagCompensation"),
+	LagCompensationEnabled,
+	TEXT("Trace client shots against pawns moved back to the time the client fired (0 = trace against the current world)"),
+	ECVF_Default);
+
+static float LagCompensationMaxRewind = 0.5f;
+FAutoConsoleVariableRef CVARLagCompensationMaxRewind(
+	TEXT("COOP.LagCompensation.MaxRewind"),
+	LagCompensationMaxRewind,
+	TEXT("Seconds pawns are moved back at most, clients with a higher latency have to lead their targets"),
+	ECVF_Default);
+
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Record"), STAT_LagCompensationRecord, STATGROUP_CoopGame);
+DECLARE_CYCLE_STAT(TEXT("Lag Compensation Rewind"), STAT_LagCompensationRewind, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Lag Compensation Traces"), STAT_LagCompensationTraces, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Lag Compensation Pawns Rewound"), STAT_LagCompensationPawnsRewound, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hitbox Sets Tested"), STAT_HitboxTests, STATGROUP_CoopGame);
+DECLARE_MEMORY_STAT(TEXT("Lag Compensation History"), STAT_LagCompensationMemory, STATGROUP_CoopGame);
+
+
+ASLagCompensation::ASLagCompensation()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	// Record where pawns ended up after movement and physics
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+
+	for (int32 Slot = 0; Slot < MaxPawns; Slot++)
+	{
+		PawnRadii[Slot] = 0.0f;
+		PawnRegisterTimes[Slot] = 0.0f;
+		PawnHitboxes[Slot] = nullptr;
+		PawnMeshes[Slot] = nullptr;
+	}
+
+	NumPawns = 0;
+	NextFrame = 0;
+	NumFrames = 0;
+	bRecordHistory = false;
+}
+
+
+void ASLagCompensation::RegisterPawn(APawn* Pawn, const TArray<FSHitbox>* Hitboxes)
+{
+	if (Pawn == nullptr)
+	{
+		return;
+	}
+
+	// Only shots from remote clients are rewound, so only servers with clients keep a history
+	const bool bServer = GetNetMode() == NM_ListenServer || GetNetMode() == NM_DedicatedServer;
+	if (bServer && FrameTimes.Num() == 0)
+	{
+		// Allocated once, the history never grows
+		FrameTimes.SetNumZeroed(MaxFrames);
+		Locations.SetNumZeroed(MaxFrames * MaxPawns);
+		Rotations.Init(FQuat::Identity, MaxFrames * MaxPawns);
+		bRecordHistory = true;
+
+		INC_MEMORY_STAT_BY(STAT_LagCompensationMemory, FrameTimes.GetAllocatedSize() + Locations.GetAllocatedSize() + Rotations.GetAllocatedSize());
+	}
+
+	for (int32 Slot = 0; Slot < MaxPawns; Slot++)
+	{
+		if (!Pawns[Slot].IsValid())
+		{
+			// Slots of destroyed pawns are still counted until the next recorded frame
+			if (!Pawns[Slot].IsExplicitlyNull())
+			{
+				NumPawns--;
+			}
+
+			FVector Origin;
+			FVector BoxExtent;
+			Pawn->GetActorBounds(true, Origin, BoxExtent);
+
+			Pawns[Slot] = Pawn;
+			PawnRadii[Slot] = (Origin - Pawn->GetActorLocation()).Size() + BoxExtent.Size();
+			PawnRegisterTimes[Slot] = GetWorld()->TimeSeconds;
+			PawnHitboxes[Slot] = Hitboxes;
+			PawnMeshes[Slot] = Pawn->FindComponentByClass<USkeletalMeshComponent>();
+			NumPawns++;
+
+			if (bRecordHistory)
+			{
+				SetActorTickEnabled(true);
+			}
+			return;
+		}
+	}
+
+	UE_LOG(LogTemp, Warning, TEXT("Lag compensation is full (%d pawns), %s is not compensated"), MaxPawns, *Pawn->GetName());
+}
+
+
+void ASLagCompensation::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	RecordFrame();
+
+	if (NumPawns == 0)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+
+void ASLagCompensation::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	DEC_MEMORY_STAT_BY(STAT_LagCompensationMemory, FrameTimes.GetAllocatedSize() + Locations.GetAllocatedSize() + Rotations.GetAllocatedSize());
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
+void ASLagCompensation::RecordFrame()
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationRecord);
+
+	const int32 Frame = NextFrame;
+	FrameTimes[Frame] = GetWorld()->TimeSeconds;
+
+	FVector* FrameLocations = &Locations[Frame * MaxPawns];
+	FQuat* FrameRotations = &Rotations[Frame * MaxPawns];
+
+	for (int32 Slot = 0; Slot < MaxPawns; Slot++)
+	{
+		APawn* Pawn = Pawns[Slot].Get();
+		if (Pawn == nullptr)
+		{
+			if (!Pawns[Slot].IsExplicitlyNull())
+			{
+				Pawns[Slot].Reset();
+				NumPawns--;
+			}
+
+			continue;
+		}
+
+		FrameLocations[Slot] = Pawn->GetActorLocation();
+		FrameRotations[Slot] = Pawn->GetActorQuat();
+	}
+
+	NextFrame = (NextFrame + 1) % MaxFrames;
+	NumFrames = FMath::Min(NumFrames + 1, MaxFrames);
+}
+
+
+bool ASLagCompensation::FindFrames(float Time, int32& OutOlderFrame, int32& OutNewerFrame, float& OutAlpha) const
+{
+	if (NumFrames == 0)
+	{
+		return false;
+	}
+
+	const int32 OldestFrame = (NextFrame - NumFrames + MaxFrames) % MaxFrames;
+	const int32 NewestFrame = (NextFrame - 1 + MaxFrames) % MaxFrames;
+
+	// Nothing to rewind
+	if (Time >= FrameTimes[NewestFrame])
+	{
+		return false;
+	}
+
+	if (Time <= FrameTimes[OldestFrame])
+	{
+		OutOlderFrame = OldestFrame;
+		OutNewerFrame = OldestFrame;
+		OutAlpha = 0.0f;
+		return true;
+	}
+
+	// Last frame at or before Time, counted from the oldest frame
+	int32 Low = 0;
+	int32 High = NumFrames - 1;
+	while (Low < High)
+	{
+		const int32 Mid = (Low + High + 1) / 2;
+		if (FrameTimes[(OldestFrame + Mid) % MaxFrames] <= Time)
+		{
+			Low = Mid;
+		}
+		else
+		{
+			High = Mid - 1;
+		}
+	}
+
+	OutOlderFrame = (OldestFrame + Low) % MaxFrames;
+	OutNewerFrame = (OutOlderFrame + 1) % MaxFrames;
+
+	const float FrameDelta = FrameTimes[OutNewerFrame] - FrameTimes[OutOlderFrame];
+	OutAlpha = FrameDelta > KINDA_SMALL_NUMBER ? (Time - FrameTimes[OutOlderFrame]) / FrameDelta : 0.0f;
+	return true;
+}
+
+
+FTransform ASLagCompensation::GetInterpolatedTransform(int32 PawnSlot, int32 OlderFrame, int32 NewerFrame, float Alpha) const
+{
+	const int32 Older = OlderFrame * MaxPawns + PawnSlot;
+	const int32 Newer = NewerFrame * MaxPawns + PawnSlot;
+
+	return FTransform(FQuat::Slerp(Rotations[Older], Rotations[Newer], Alpha), FMath::Lerp(Locations[Older], Locations[Newer], Alpha));
+}
+
+
+bool ASLagCompensation::GetRewoundTransform(const APawn* Pawn, float RewindTime, FTransform& OutTransform) const
+{
+	for (int32 Slot = 0; Slot < MaxPawns; Slot++)
+	{
+		if (Pawns[Slot].Get() == Pawn && Pawn != nullptr)
+		{
+			int32 OlderFrame;
+			int32 NewerFrame;
+			float Alpha;
+			if (FindFrames(RewindTime, OlderFrame, NewerFrame, Alpha) && FrameTimes[OlderFrame] >= PawnRegisterTimes[Slot])
+			{
+				OutTransform = GetInterpolatedTransform(Slot, OlderFrame, NewerFrame, Alpha);
+				OutTransform.SetScale3D(Pawn->GetActorScale3D());
+			}
+			else
+			{
+				OutTransform = Pawn->GetActorTransform();
+			}
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+bool ASLagCompensation::LineTraceShot(FHitResult& OutHit, const FVector& Start, const FVector& End, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params, float RewindTime)
+{
+	UWorld* World = GetWorld();
+
+	if (NumPawns == 0)
+	{
+		return World->LineTraceSingleByChannel(OutHit, Start, End, TraceChannel, Params);
+	}
+
+	// Trace the world without the registered pawns first, they are tested one by one after
+	FCollisionQueryParams WorldParams = Params;
+	AddIgnoredPawns(WorldParams);
+
+	const bool bHit = World->LineTraceSingleByChannel(OutHit, Start, End, TraceChannel, WorldParams);
+
+	return LineTracePawns(OutHit, Start, End, TraceChannel, Params, RewindTime, bHit ? OutHit.Time : 1.0f) || bHit;
+}
+
+
+void ASLagCompensation::AddIgnoredPawns(FCollisionQueryParams& Params) const
+{
+	for (int32 Slot = 0; Slot < MaxPawns; Slot++)
+	{
+		if (APawn* Pawn = Pawns[Slot].Get())
+		{
+			Params.AddIgnoredActor(Pawn);
+		}
+	}
+}
+
+
+bool ASLagCompensation::LineTracePawns(FHitResult& OutHit, const FVector& Start, const FVector& End, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params, float RewindTime, float MaxTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationRewind);
+
+	if (NumPawns == 0)
+	{
+		return false;
+	}
+
+	int32 OlderFrame = INDEX_NONE;
+	int32 NewerFrame = INDEX_NONE;
+	float Alpha = 0.0f;
+	const bool bRewind = FindRewindFrames(RewindTime, OlderFrame, NewerFrame, Alpha);
+
+	bool bHit = false;
+	float BestTime = MaxTime;
+
+	for (int32 Slot = 0; Slot < MaxPawns; Slot++)
+	{
+		APawn* Pawn = Pawns[Slot].Get();
+		if (Pawn == nullptr || Params.GetIgnoredActors().Contains(Pawn->GetUniqueID()))
+		{
+			continue;
+		}
+
+		const FTransform Current = Pawn->GetActorTransform();
+		const FTransform Rewound = GetPawnTransform(Slot, Current, bRewind, OlderFrame, NewerFrame, Alpha);
+
+		if (FMath::PointDistToSegmentSquared(Rewound.GetLocation(), Start, End) > FMath::Square(PawnRadii[Slot]))
+		{
+			continue;
+		}
+
+		if (bRewind)
+		{
+			INC_DWORD_STAT(STAT_LagCompensationPawnsRewound);
+		}
+
+		FHitResult PawnHit;
+		if (LineTracePawnSlot(Slot, Pawn, Current, Rewound, Start, End, TraceChannel, Params, PawnHit) && PawnHit.Time < BestTime)
+		{
+			OutHit = PawnHit;
+			BestTime = PawnHit.Time;
+			bHit = true;
+		}
+	}
+
+	return bHit;
+}
+
+
+int32 ASLagCompensation::LineTraceShots(TArray<FHitResult>& OutHits, const FVector& Start, const TArray<FVector>& Ends, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params, float RewindTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LagCompensationRewind);
+
+	UWorld* World = GetWorld();
+
+	OutHits.Reset(Ends.Num());
+	OutHits.SetNum(Ends.Num());
+
+	// The world part of every ray first, with the registered pawns left out
+	FCollisionQueryParams WorldParams = Params;
+	AddIgnoredPawns(WorldParams);
+
+	TArray<float, TInlineAllocator<32>> BestTimes;
+	BestTimes.SetNumUninitialized(Ends.Num());
+
+	for (int32 i = 0; i < Ends.Num(); i++)
+	{
+		const bool bHit = World->LineTraceSingleByChannel(OutHits[i], Start, Ends[i], TraceChannel, WorldParams);
+		OutHits[i].bBlockingHit = bHit;
+		BestTimes[i] = bHit ? OutHits[i].Time : 1.0f;
+	}
+
+	// Then every pawn is placed once and tested against all rays that pass close to it
+	if (NumPawns > 0)
+	{
+		int32 OlderFrame = INDEX_NONE;
+		int32 NewerFrame = INDEX_NONE;
+		float Alpha = 0.0f;
+		const bool bRewind = FindRewindFrames(RewindTime, OlderFrame, NewerFrame, Alpha);
+
+		for (int32 Slot = 0; Slot < MaxPawns; Slot++)
+		{
+			APawn* Pawn = Pawns[Slot].Get();
+			if (Pawn == nullptr || Params.GetIgnoredActors().Contains(Pawn->GetUniqueID()))
+			{
+				continue;
+			}
+
+			const FTransform Current = Pawn->GetActorTransform();
+			const FTransform Rewound = GetPawnTransform(Slot, Current, bRewind, OlderFrame, NewerFrame, Alpha);
+			const float RadiusSquared = FMath::Square(PawnRadii[Slot]);
+			bool bTested = false;
+
+			for (int32 i = 0; i < Ends.Num(); i++)
+			{
+				if (FMath::PointDistToSegmentSquared(Rewound.GetLocation(), Start, Ends[i]) > RadiusSquared)
+				{
+					continue;
+				}
+
+				bTested = true;
+
+				FHitResult PawnHit;
+				if (LineTracePawnSlot(Slot, Pawn, Current, Rewound, Start, Ends[i], TraceChannel, Params, PawnHit) && PawnHit.Time < BestTimes[i])
+				{
+					OutHits[i] = PawnHit;
+					BestTimes[i] = PawnHit.Time;
+				}
+			}
+
+			if (bRewind && bTested)
+			{
+				INC_DWORD_STAT(STAT_LagCompensationPawnsRewound);
+			}
+		}
+	}
+
+	int32 NumHits = 0;
+	for (const FHitResult& Hit : OutHits)
+	{
+		NumHits += Hit.bBlockingHit ? 1 : 0;
+	}
+
+	return NumHits;
+}
+
+
+bool ASLagCompensation::FindRewindFrames(float RewindTime, int32& OutOlderFrame, int32& OutNewerFrame, float& OutAlpha) const
+{
+	// Without a rewind time (or history) pawns are tested where they are now
+	if (RewindTime < 0.0f || LagCompensationEnabled == 0)
+	{
+		return false;
+	}
+
+	RewindTime = FMath::Max(RewindTime, GetWorld()->TimeSeconds - LagCompensationMaxRewind);
+	if (!FindFrames(RewindTime, OutOlderFrame, OutNewerFrame, OutAlpha))
+	{
+		return false;
+	}
+
+	INC_DWORD_STAT(STAT_LagCompensationTraces);
+	return true;
+}
+
+
+FTransform ASLagCompensation::GetPawnTransform(int32 PawnSlot, const FTransform& Current, bool bRewind, int32 OlderFrame, int32 NewerFrame, float Alpha) const
+{
+	// Pawns that did not exist back then are where they are now
+	if (!bRewind || FrameTimes[OlderFrame] < PawnRegisterTimes[PawnSlot])
+	{
+		return Current;
+	}
+
+	FTransform Rewound = GetInterpolatedTransform(PawnSlot, OlderFrame, NewerFrame, Alpha);
+	Rewound.SetScale3D(Current.GetScale3D());
+	return Rewound;
+}
+
+
+/* Hitboxes ignore collision, so they follow whether the pawn's own collision would still be hit (not after dying or exploding) */
+static bool CanHitboxesBeHit(const APawn* Pawn, const USkeletalMeshComponent* Mesh, ECollisionChannel TraceChannel)
+{
+	const UPrimitiveComponent* Root = Cast<UPrimitiveComponent>(Pawn->GetRootComponent());
+	if (Root && !CollisionEnabledHasQuery(Root->GetCollisionEnabled()))
+	{
+		return false;
+	}
+
+	// Characters leave shots to their mesh, their capsule ignores weapons
+	const UPrimitiveComponent* ShotComponent = Mesh ? Mesh : Root;
+	if (ShotComponent == nullptr)
+	{
+		return true;
+	}
+
+	return CollisionEnabledHasQuery(ShotComponent->GetCollisionEnabled()) && ShotComponent->GetCollisionResponseToChannel(TraceChannel) != ECR_Ignore;
+}
+
+
+bool ASLagCompensation::LineTracePawnSlot(int32 PawnSlot, APawn* Pawn, const FTransform& Current, const FTransform& Rewound, const FVector& Start, const FVector& End, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params, FHitResult& OutHit) const
+{
+	// Hitboxes are plain math, they can be placed at the rewound transform directly
+	const TArray<FSHitbox>* Hitboxes = PawnHitboxes[PawnSlot];
+	if (Hitboxes && Hitboxes->Num() > 0)
+	{
+		if (!CanHitboxesBeHit(Pawn, PawnMeshes[PawnSlot], TraceChannel))
+		{
+			return false;
+		}
+
+		INC_DWORD_STAT(STAT_HitboxTests);
+
+		return FSHitbox::LineTraceHitboxes(*Hitboxes, Pawn, Rewound, PawnMeshes[PawnSlot], Start, End, OutHit);
+	}
+
+	// Instead of moving the pawn back, move the ray into where the pawn is now
+	const FVector CurrentStart = Current.TransformPosition(Rewound.InverseTransformPosition(Start));
+	const FVector CurrentEnd = Current.TransformPosition(Rewound.InverseTransformPosition(End));
+
+	if (!Pawn->ActorLineTraceSingle(OutHit, CurrentStart, CurrentEnd, TraceChannel, Params))
+	{
+		return false;
+	}
+
+	// And the hit back to where the pawn was
+	OutHit.Location = Rewound.TransformPosition(Current.InverseTransformPosition(OutHit.Location));
+	OutHit.ImpactPoint = Rewound.TransformPosition(Current.InverseTransformPosition(OutHit.ImpactPoint));
+	OutHit.Normal = Rewound.TransformVectorNoScale(Current.InverseTransformVectorNoScale(OutHit.Normal));
+	OutHit.ImpactNormal = Rewound.TransformVectorNoScale(Current.InverseTransformVectorNoScale(OutHit.ImpactNormal));
+	OutHit.TraceStart = Start;
+	OutHit.TraceEnd = End;
+	return true;
+}
+
+
+const FSHitbox* ASLagCompensation::GetHitbox(const FHitResult& Hit) const
+{
+	const AActor* HitActor = Hit.GetActor();
+	if (HitActor == nullptr)
+	{
+		return nullptr;
+	}
+
+	for (int32 Slot = 0; Slot < MaxPawns; Slot++)
+	{
+		if (Pawns[Slot].Get() == HitActor)
+		{
+			// Pawns with hitboxes are only ever hit through them
+			const TArray<FSHitbox>* Hitboxes = PawnHitboxes[Slot];
+			return Hitboxes && Hitboxes->IsValidIndex(Hit.Item) ? &(*Hitboxes)[Hit.Item] : nullptr;
+		}
+	}
+
+	return nullptr;
+}
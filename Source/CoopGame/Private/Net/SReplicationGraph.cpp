@@ -0,0 +1,320 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SReplicationGraph.h"
+#include "SCharacter.h"
+#include "SWeapon.h"
+#include "SPlayerState.h"
+#include "SGameState.h"
+#include "SPickupActor.h"
+#include "SPowerupActor.h"
+#include "STrackerBot.h"
+#include "SExplosiveBarrel.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "Engine/LevelScriptActor.h"
+#include "Engine/NetDriver.h"
+#include "EngineUtils.h"
+
+static float RepGraphCellSize = 10000.0f;
+FAutoConsoleVariableRef CVARRepGraphCellSize(
+	TEXT("COOP.RepGraph.CellSize"),
+	RepGraphCellSize,
+	TEXT("Size of a spatial grid cell in the replication graph, only read when the graph is created"),
+	ECVF_Default);
+
+static float RepGraphSpatialBias = -100000.0f;
+FAutoConsoleVariableRef CVARRepGraphSpatialBias(
+	TEXT("COOP.RepGraph.SpatialBias"),
+	RepGraphSpatialBias,
+	TEXT("Offset of the spatial grid origin (X and Y), so maps centered around the world origin stay inside the grid"),
+	ECVF_Default);
+
+
+static bool IsSpatialized(ESClassRepNodeMapping Mapping)
+{
+	return Mapping >= ESClassRepNodeMapping::Spatialize_Static;
+}
+
+
+USReplicationGraph::USReplicationGraph()
+{
+}
+
+
+void USReplicationGraph::SetClassSettings(UClass* Class, ESClassRepNodeMapping Mapping, uint32 ReplicationPeriodFrame, float CullDistance)
+{
+	ClassRepNodePolicies.Set(Class, Mapping);
+
+	AActor* ActorCDO = Class->GetDefaultObject<AActor>();
+
+	FClassReplicationInfo ClassInfo;
+	ClassInfo.ReplicationPeriodFrame = ReplicationPeriodFrame > 0 ? ReplicationPeriodFrame :
+		FMath::Max<uint32>((uint32)FMath::RoundToFloat(NetDriver->NetServerMaxTickRate / ActorCDO->NetUpdateFrequency), 1);
+
+	if (IsSpatialized(Mapping))
+	{
+		ClassInfo.CullDistanceSquared = CullDistance * CullDistance;
+	}
+
+	GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+	ExplicitlySetClasses.Add(Class);
+}
+
+
+void USReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	// ------- EXPLICIT CLASSES ------- \\
+
+	// Routing and net rate of everything the horde mode spawns in numbers.
+	// Period is in server frames (1 = every frame), cull distance in cm.
+
+	SetClassSettings(ASGameState::StaticClass(), ESClassRepNodeMapping::RelevantAllConnections, 0, 0.0f);
+
+	// Own player state goes through the per-connection node, the others through the frequency limiter
+	SetClassSettings(APlayerState::StaticClass(), ESClassRepNodeMapping::NotRouted, 1, 0.0f);
+	SetClassSettings(APlayerController::StaticClass(), ESClassRepNodeMapping::NotRouted, 1, 0.0f);
+
+	SetClassSettings(ASCharacter::StaticClass(), ESClassRepNodeMapping::Spatialize_Dynamic, 1, 15000.0f);
+
+	// Weapons carry HitScanBurst for the impact effects of other players, keep them at full rate
+	SetClassSettings(ASWeapon::StaticClass(), ESClassRepNodeMapping::Spatialize_Dynamic, 1, 15000.0f);
+
+	SetClassSettings(ASTrackerBot::StaticClass(), ESClassRepNodeMapping::Spatialize_Dynamic, 2, 10000.0f);
+
+	// Dormant until something happens to them, see ASPickupActor, ASPowerupActor and ASExplosiveBarrel
+	SetClassSettings(ASExplosiveBarrel::StaticClass(), ESClassRepNodeMapping::Spatialize_Dormancy, 2, 10000.0f);
+	SetClassSettings(ASPickupActor::StaticClass(), ESClassRepNodeMapping::Spatialize_Dormancy, 3, 10000.0f);
+	SetClassSettings(ASPowerupActor::StaticClass(), ESClassRepNodeMapping::Spatialize_Dormancy, 3, 10000.0f);
+
+	// Replicated for its properties only, never needs a channel. Listed as explicit so the legacy pass below
+	// does not route it (and level Blueprints derived from it) as always relevant.
+	ClassRepNodePolicies.Set(ALevelScriptActor::StaticClass(), ESClassRepNodeMapping::NotRouted);
+	ExplicitlySetClasses.Add(ALevelScriptActor::StaticClass());
+
+	// ------- LEGACY CLASSES ------- \\
+
+	// Everything else (engine and Blueprint-only classes) is routed from its legacy relevancy flags
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject());
+		if (ActorCDO == nullptr || !ActorCDO->GetIsReplicated())
+		{
+			continue;
+		}
+
+		// Skip Blueprint skeleton and reinstanced classes
+		if (Class->GetName().StartsWith(TEXT("SKEL_")) || Class->GetName().StartsWith(TEXT("REINST_")))
+		{
+			continue;
+		}
+
+		if (ExplicitlySetClasses.ContainsByPredicate([Class](const UClass* SetClass) { return Class->IsChildOf(SetClass); }))
+		{
+			continue;
+		}
+
+		ESClassRepNodeMapping Mapping = ESClassRepNodeMapping::NotRouted;
+		if (ActorCDO->bAlwaysRelevant && !ActorCDO->bOnlyRelevantToOwner)
+		{
+			Mapping = ESClassRepNodeMapping::RelevantAllConnections;
+		}
+		else if (!ActorCDO->bAlwaysRelevant && !ActorCDO->bOnlyRelevantToOwner && !ActorCDO->bNetUseOwnerRelevancy)
+		{
+			Mapping = ActorCDO->bReplicateMovement ? ESClassRepNodeMapping::Spatialize_Dynamic : ESClassRepNodeMapping::Spatialize_Static;
+		}
+
+		ClassRepNodePolicies.Set(Class, Mapping);
+
+		FClassReplicationInfo ClassInfo;
+		ClassInfo.ReplicationPeriodFrame = FMath::Max<uint32>((uint32)FMath::RoundToFloat(NetDriver->NetServerMaxTickRate / ActorCDO->NetUpdateFrequency), 1);
+		if (IsSpatialized(Mapping))
+		{
+			ClassInfo.CullDistanceSquared = ActorCDO->NetCullDistanceSquared;
+		}
+
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+	}
+}
+
+
+void USReplicationGraph::InitGlobalGraphNodes()
+{
+	// Preallocate some replication lists
+	PreAllocateRepList(3, 12);
+	PreAllocateRepList(6, 12);
+	PreAllocateRepList(128, 64);
+	PreAllocateRepList(512, 16);
+
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = RepGraphCellSize;
+	GridNode->SpatialBias = FVector2D(RepGraphSpatialBias, RepGraphSpatialBias);
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+
+	USReplicationGraphNode_PlayerStateFrequencyLimiter* PlayerStateNode = CreateNewNode<USReplicationGraphNode_PlayerStateFrequencyLimiter>();
+	AddGlobalGraphNode(PlayerStateNode);
+}
+
+
+void USReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	USReplicationGraphNode_AlwaysRelevant_ForConnection* ConnectionNode = CreateNewNode<USReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(ConnectionNode, RepGraphConnection);
+}
+
+
+ESClassRepNodeMapping USReplicationGraph::GetMappingPolicy(UClass* Class)
+{
+	ESClassRepNodeMapping* Mapping = ClassRepNodePolicies.Get(Class);
+	return Mapping ? *Mapping : ESClassRepNodeMapping::NotRouted;
+}
+
+
+void USReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case ESClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+
+	case ESClassRepNodeMapping::Spatialize_Static:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+
+	case ESClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+
+	case ESClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+
+	default:
+		break;
+	}
+}
+
+
+void USReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case ESClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+
+	case ESClassRepNodeMapping::Spatialize_Static:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+
+	case ESClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+
+	case ESClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+
+	default:
+		break;
+	}
+}
+
+
+void USReplicationGraphNode_AlwaysRelevant_ForConnection::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	ReplicationActorList.Reset();
+
+	ReplicationActorList.ConditionalAdd(Params.Viewer.InViewer);
+	ReplicationActorList.ConditionalAdd(Params.Viewer.ViewTarget);
+
+	APlayerController* PC = Cast<APlayerController>(Params.Viewer.InViewer);
+	if (PC)
+	{
+		APlayerState* PlayerState = PC->PlayerState;
+		if (PlayerState)
+		{
+			if (!bInitializedPlayerState)
+			{
+				// The owning player always gets its own player state at full rate
+				FConnectionReplicationActorInfo& ConnectionActorInfo = Params.ConnectionManager.ActorInfoMap.FindOrAdd(PlayerState);
+				ConnectionActorInfo.ReplicationPeriodFrame = 1;
+				bInitializedPlayerState = true;
+			}
+
+			ReplicationActorList.ConditionalAdd(PlayerState);
+
+			// Our whole inventory, holstered weapons wait hidden wherever they were put away
+			ASPlayerState* SPlayerState = Cast<ASPlayerState>(PlayerState);
+			if (SPlayerState)
+			{
+				for (ASWeapon* Weapon : SPlayerState->GetWeapons())
+				{
+					ReplicationActorList.ConditionalAdd(Weapon);
+				}
+			}
+		}
+
+		// Our own pawn and weapon, even while spectating something else
+		ASCharacter* Pawn = Cast<ASCharacter>(PC->GetPawn());
+		if (Pawn)
+		{
+			ReplicationActorList.ConditionalAdd(Pawn);
+			ReplicationActorList.ConditionalAdd(Pawn->GetCurrentWeapon());
+		}
+	}
+
+	Params.OutGatheredReplicationLists.AddReplicationActorList(ReplicationActorList);
+}
+
+
+USReplicationGraphNode_PlayerStateFrequencyLimiter::USReplicationGraphNode_PlayerStateFrequencyLimiter()
+{
+	bRequiresPrepareForReplicationCall = true;
+
+	TargetActorsPerFrame = 2;
+}
+
+
+void USReplicationGraphNode_PlayerStateFrequencyLimiter::PrepareForReplication()
+{
+	ReplicationActorLists.Reset();
+
+	ReplicationActorLists.AddDefaulted();
+	FActorRepListRefView* CurrentList = &ReplicationActorLists[0];
+	CurrentList->PrepareForWrite();
+
+	// Rebuilt every frame, a handful of player states is cheap and keeps the lists compact when players leave
+	for (TActorIterator<APlayerState> It(GetWorld()); It; ++It)
+	{
+		APlayerState* PlayerState = *It;
+		if (!IsActorValidForReplicationGather(PlayerState))
+		{
+			continue;
+		}
+
+		if (CurrentList->Num() >= TargetActorsPerFrame)
+		{
+			ReplicationActorLists.AddDefaulted();
+			CurrentList = &ReplicationActorLists.Last();
+			CurrentList->PrepareForWrite();
+		}
+
+		CurrentList->Add(PlayerState);
+	}
+}
+
+
+void USReplicationGraphNode_PlayerStateFrequencyLimiter::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	const int32 ListIndex = Params.ReplicationFrameNum % ReplicationActorLists.Num();
+	Params.OutGatheredReplicationLists.AddReplicationActorList(ReplicationActorLists[ListIndex]);
+}
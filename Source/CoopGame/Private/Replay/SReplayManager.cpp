@@ -0,0 +1,684 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SReplayManager.h"
+#include "SCharacter.h"
+#include "SWeapon.h"
+#include "SGameState.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PawnMovementComponent.h"
+#include "HAL/FileManager.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+
+// Width of a single frame time histogram bucket and the amount of buckets (last bucket collects everything above)
+static const double FrameTimeBucketMs = 0.5;
+static const int32 NumFrameTimeBuckets = 201;
+
+
+ASReplayManager::ASReplayManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	// Inputs must be applied before pawns and their movement components tick
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	Mode = EReplayMode::None;
+	Seed = 0;
+	FrameNumber = 0;
+	WaveStateMismatches = 0;
+	NumPlaybackShots = 0;
+	ShotMismatches = 0;
+	LastFrameRealTime = 0.0;
+}
+
+
+void ASReplayManager::StartFromCommandLine(const UObject* WorldContextObject)
+{
+	FString Filename;
+	if (FParse::Value(FCommandLine::Get(), TEXT("ReplayRecord="), Filename))
+	{
+		ASReplayManager* Manager = ASWorldManager::Get<ASReplayManager>(WorldContextObject);
+		if (Manager && Manager->GetNetMode() != NM_Client)
+		{
+			Manager->StartRecording(Filename);
+		}
+	}
+	else if (FParse::Value(FCommandLine::Get(), TEXT("ReplayPlay="), Filename))
+	{
+		// Recorded players were remote clients, a standalone game would add its own local player on top
+		ASReplayManager* Manager = ASWorldManager::Get<ASReplayManager>(WorldContextObject);
+		if (Manager && Manager->GetNetMode() == NM_DedicatedServer)
+		{
+			Manager->StartPlayback(Filename);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Replay playback requires a dedicated server (-server)"));
+		}
+	}
+}
+
+
+bool ASReplayManager::IsRecording(const UObject* WorldContextObject)
+{
+	ASReplayManager* Manager = ASWorldManager::Get<ASReplayManager>(WorldContextObject, false);
+	return Manager && Manager->Mode == EReplayMode::Recording;
+}
+
+
+bool ASReplayManager::IsPlayingBack(const UObject* WorldContextObject)
+{
+	ASReplayManager* Manager = ASWorldManager::Get<ASReplayManager>(WorldContextObject, false);
+	return Manager && Manager->Mode == EReplayMode::Playback;
+}
+
+
+int32 ASReplayManager::GetRandomSeed(const UObject* WorldContextObject)
+{
+	ASReplayManager* Manager = ASWorldManager::Get<ASReplayManager>(WorldContextObject, false);
+	if (Manager && Manager->Mode != EReplayMode::None)
+	{
+		return (int32)Manager->RandomStream.GetUnsignedInt();
+	}
+
+	return FMath::Rand();
+}
+
+
+bool ASReplayManager::StartRecording(const FString& Filename)
+{
+	ReplayFilename = FPaths::IsRelative(Filename) ? FPaths::ProjectSavedDir() / TEXT("Replays") / Filename : Filename;
+
+	Archive.Reset(IFileManager::Get().CreateFileWriter(*ReplayFilename));
+	if (!Archive.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to open replay %s for writing"), *ReplayFilename);
+		return false;
+	}
+
+	if (!FParse::Value(FCommandLine::Get(), TEXT("ReplaySeed="), Seed))
+	{
+		Seed = (int32)FPlatformTime::Cycles();
+	}
+
+	// Seeds handed out from here on (weapon spread) follow the recorded seed
+	RandomStream.Initialize(Seed);
+
+	uint32 Magic = SREPLAY_MAGIC;
+	uint32 Version = SREPLAY_VERSION;
+	FString MapName = GetWorld()->GetMapName();
+	*Archive << Magic << Version << Seed << MapName;
+
+	// Empty first frame, owns the events from match start until our first tick
+	uint8 Tag = (uint8)ESReplayRecord::Frame;
+	float DeltaSeconds = 0.0f;
+	uint8 NumInputs = 0;
+	*Archive << Tag << DeltaSeconds << NumInputs;
+
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &ASReplayManager::OnActorSpawned));
+
+	Mode = EReplayMode::Recording;
+	SetActorTickEnabled(true);
+
+	UE_LOG(LogTemp, Log, TEXT("Recording replay to %s (Seed: %d)"), *ReplayFilename, Seed);
+	return true;
+}
+
+
+bool ASReplayManager::StartPlayback(const FString& Filename)
+{
+	ReplayFilename = FPaths::IsRelative(Filename) ? FPaths::ProjectSavedDir() / TEXT("Replays") / Filename : Filename;
+
+	Archive.Reset(IFileManager::Get().CreateFileReader(*ReplayFilename));
+	if (!Archive.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to open replay %s for reading"), *ReplayFilename);
+		return false;
+	}
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	FString MapName;
+	*Archive << Magic << Version << Seed << MapName;
+
+	if (Magic != SREPLAY_MAGIC || Version != SREPLAY_VERSION)
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s is not a replay this build can play (version %u)"), *ReplayFilename, Version);
+		Archive.Reset();
+		return false;
+	}
+
+	if (MapName != GetWorld()->GetMapName())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Replay was recorded on %s but is played back on %s"), *MapName, *GetWorld()->GetMapName());
+	}
+
+	RandomStream.Initialize(Seed);
+
+	// Run as fast as possible with the recorded frame deltas
+	FApp::SetUseFixedTimeStep(true);
+
+	Mode = EReplayMode::Playback;
+
+	if (ReadFrame(NextFrame))
+	{
+		FApp::SetFixedDeltaTime(NextFrame.DeltaSeconds);
+	}
+
+	SetActorTickEnabled(true);
+
+	UE_LOG(LogTemp, Log, TEXT("Playing back replay %s (Seed: %d)"), *ReplayFilename, Seed);
+	return true;
+}
+
+
+void ASReplayManager::Stop()
+{
+	if (Mode == EReplayMode::None)
+	{
+		return;
+	}
+
+	if (Mode == EReplayMode::Recording)
+	{
+		uint8 Tag = (uint8)ESReplayRecord::EndOfStream;
+		*Archive << Tag;
+
+		GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+	}
+	else
+	{
+		FApp::SetUseFixedTimeStep(false);
+
+		int32 NumChecked = FMath::Min(ExpectedWaveStates.Num(), ObservedWaveStates.Num());
+		WaveStateMismatches += FMath::Abs(ExpectedWaveStates.Num() - ObservedWaveStates.Num());
+
+		UE_LOG(LogTemp, Log, TEXT("Replay finished after %d frames, %d of %d wave states and %d of %d shots diverged"), FrameNumber, WaveStateMismatches, NumChecked,
+			ShotMismatches, NumPlaybackShots);
+	}
+
+	Archive->Close();
+	Archive.Reset();
+
+	WriteFrameTimeHistogram();
+
+	Mode = EReplayMode::None;
+	SetActorTickEnabled(false);
+}
+
+
+void ASReplayManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Stop();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
+void ASReplayManager::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	double Now = FPlatformTime::Seconds();
+	if (LastFrameRealTime > 0.0)
+	{
+		AddFrameTime(Now - LastFrameRealTime);
+	}
+	LastFrameRealTime = Now;
+
+	if (Mode == EReplayMode::Recording)
+	{
+		RecordFrame(DeltaSeconds);
+	}
+	else if (Mode == EReplayMode::Playback)
+	{
+		PlaybackFrame();
+	}
+
+	FrameNumber++;
+}
+
+// ------- RECORDING ------- \\
+
+void ASReplayManager::RecordFrame(float DeltaSeconds)
+{
+	TArray<TPair<uint8, FSReplayPlayerInput>, TInlineAllocator<8>> Inputs;
+	TArray<FSReplayShot> Shots;
+	TArray<FSReplayAmmoEvent> AmmoEvents;
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PC = It->Get();
+		ASCharacter* Character = PC ? Cast<ASCharacter>(PC->GetPawn()) : nullptr;
+		if (Character == nullptr)
+		{
+			continue;
+		}
+
+		uint8* Slot = PlayerSlots.Find(PC);
+		if (Slot == nullptr)
+		{
+			Slot = &PlayerSlots.Add(PC, (uint8)PlayerSlots.Num());
+
+			// Players already holding a weapon when the recording starts never equip it in the stream
+			ASWeapon* Weapon = Character->GetCurrentWeapon();
+			if (Weapon)
+			{
+				FSReplayAmmoEvent Event;
+				Event.Type = ESReplayAmmoEvent::Equip;
+				Event.Ammo = (uint16)FMath::Clamp(FMath::RoundToInt(Weapon->CurrentAmmo), 0, (int32)MAX_uint16);
+				PendingAmmoEvents.FindOrAdd(PC).Insert(Event, 0);
+			}
+		}
+
+		FSReplayPlayerInput Input;
+		Character->BuildReplayInput(Input);
+
+		if (TArray<FSReplayShot>* PlayerShots = PendingShots.Find(PC))
+		{
+			Input.NumShots = (uint8)FMath::Min(PlayerShots->Num(), (int32)MAX_uint8);
+			Shots.Append(PlayerShots->GetData(), Input.NumShots);
+		}
+
+		if (TArray<FSReplayAmmoEvent>* PlayerAmmoEvents = PendingAmmoEvents.Find(PC))
+		{
+			Input.NumAmmoEvents = (uint8)FMath::Min(PlayerAmmoEvents->Num(), (int32)MAX_uint8);
+			AmmoEvents.Append(PlayerAmmoEvents->GetData(), Input.NumAmmoEvents);
+		}
+
+		Inputs.Add(MakeTuple(*Slot, Input));
+	}
+
+	// Shots of players that lost their pawn this frame have nothing to be played back on
+	PendingShots.Reset();
+	PendingAmmoEvents.Reset();
+
+	uint8 Tag = (uint8)ESReplayRecord::Frame;
+	uint8 NumInputs = (uint8)Inputs.Num();
+	*Archive << Tag << DeltaSeconds << NumInputs;
+
+	int32 NextShot = 0;
+	int32 NextAmmoEvent = 0;
+	for (TPair<uint8, FSReplayPlayerInput>& Input : Inputs)
+	{
+		*Archive << Input.Key << Input.Value;
+
+		for (int32 i = 0; i < Input.Value.NumShots; i++)
+		{
+			*Archive << Shots[NextShot++];
+		}
+
+		for (int32 i = 0; i < Input.Value.NumAmmoEvents; i++)
+		{
+			*Archive << AmmoEvents[NextAmmoEvent++];
+		}
+	}
+}
+
+
+void ASReplayManager::RecordShot(APawn* Shooter, const FSReplayShot& Shot)
+{
+	APlayerController* PC = Shooter ? Cast<APlayerController>(Shooter->GetController()) : nullptr;
+	if (PC && Mode == EReplayMode::Recording)
+	{
+		PendingShots.FindOrAdd(PC).Add(Shot);
+	}
+}
+
+
+void ASReplayManager::RecordAmmoEvent(APawn* Owner, ESReplayAmmoEvent Type, float Ammo)
+{
+	APlayerController* PC = Owner ? Cast<APlayerController>(Owner->GetController()) : nullptr;
+	if (PC == nullptr || Mode != EReplayMode::Recording)
+	{
+		return;
+	}
+
+	// Placed between the player's shots of this frame, in the order the server saw them
+	const TArray<FSReplayShot>* PlayerShots = PendingShots.Find(PC);
+
+	FSReplayAmmoEvent Event;
+	Event.NumShotsBefore = (uint8)FMath::Min(PlayerShots ? PlayerShots->Num() : 0, (int32)MAX_uint8);
+	Event.Type = Type;
+	Event.Ammo = (uint16)FMath::Clamp(FMath::RoundToInt(Ammo), 0, (int32)MAX_uint16);
+	PendingAmmoEvents.FindOrAdd(PC).Add(Event);
+}
+
+
+void ASReplayManager::NotifyWaveState(EWaveState NewState)
+{
+	if (Mode == EReplayMode::Recording)
+	{
+		uint8 Tag = (uint8)ESReplayRecord::WaveState;
+		uint8 State = (uint8)NewState;
+		*Archive << Tag << State;
+	}
+	else if (Mode == EReplayMode::Playback)
+	{
+		ObservedWaveStates.Add(NewState);
+
+		int32 Index = ObservedWaveStates.Num() - 1;
+		if (ExpectedWaveStates.IsValidIndex(Index) && ExpectedWaveStates[Index] != NewState)
+		{
+			WaveStateMismatches++;
+			UE_LOG(LogTemp, Warning, TEXT("Replay diverged at frame %d: wave state %d, recorded %d"), FrameNumber, (int32)NewState, (int32)ExpectedWaveStates[Index]);
+		}
+	}
+}
+
+
+void ASReplayManager::OnActorSpawned(AActor* Actor)
+{
+	APawn* Pawn = Cast<APawn>(Actor);
+	if (Pawn == nullptr || Mode != EReplayMode::Recording)
+	{
+		return;
+	}
+
+	// Player pawns are restarted by the game mode, anything else is a wave director decision
+	AGameModeBase* GM = GetWorld()->GetAuthGameMode();
+	if (GM && Pawn->GetClass() == GM->DefaultPawnClass)
+	{
+		return;
+	}
+
+	FString ClassPath = Pawn->GetClass()->GetPathName();
+
+	int32 ClassIndex = BotClassTable.Num();
+	bool bNewClass = true;
+	if (int32* ExistingIndex = BotClassTable.Find(ClassPath))
+	{
+		ClassIndex = *ExistingIndex;
+		bNewClass = false;
+	}
+	else
+	{
+		BotClassTable.Add(ClassPath, ClassIndex);
+	}
+
+	uint8 Tag = (uint8)ESReplayRecord::BotSpawn;
+	FVector Location = Pawn->GetActorLocation();
+	FRotator Rotation = Pawn->GetActorRotation();
+	*Archive << Tag << ClassIndex << Location << Rotation;
+
+	if (bNewClass)
+	{
+		*Archive << ClassPath;
+	}
+}
+
+// ------- PLAYBACK ------- \\
+
+bool ASReplayManager::ReadFrame(FSReplayFrame& OutFrame)
+{
+	OutFrame = FSReplayFrame();
+
+	if (Archive->AtEnd())
+	{
+		return false;
+	}
+
+	uint8 Tag = 0;
+	*Archive << Tag;
+	if (Tag != (uint8)ESReplayRecord::Frame)
+	{
+		return false;
+	}
+
+	uint8 NumInputs = 0;
+	*Archive << OutFrame.DeltaSeconds << NumInputs;
+
+	for (int32 i = 0; i < NumInputs; i++)
+	{
+		TPair<uint8, FSReplayPlayerInput> Input;
+		*Archive << Input.Key << Input.Value;
+		OutFrame.Inputs.Add(Input);
+
+		for (int32 j = 0; j < Input.Value.NumShots; j++)
+		{
+			FSReplayShot Shot;
+			*Archive << Shot;
+			OutFrame.Shots.Add(Shot);
+		}
+
+		for (int32 j = 0; j < Input.Value.NumAmmoEvents; j++)
+		{
+			FSReplayAmmoEvent AmmoEvent;
+			*Archive << AmmoEvent;
+			OutFrame.AmmoEvents.Add(AmmoEvent);
+		}
+	}
+
+	// Read all events recorded during this frame
+	while (!Archive->AtEnd())
+	{
+		int64 EventStart = Archive->Tell();
+		*Archive << Tag;
+
+		if (Tag == (uint8)ESReplayRecord::WaveState)
+		{
+			uint8 State = 0;
+			*Archive << State;
+			OutFrame.WaveStates.Add((EWaveState)State);
+		}
+		else if (Tag == (uint8)ESReplayRecord::BotSpawn)
+		{
+			int32 ClassIndex = 0;
+			FSReplayBotSpawn BotSpawn;
+			*Archive << ClassIndex << BotSpawn.Location << BotSpawn.Rotation;
+
+			if (ClassIndex == BotClassPaths.Num())
+			{
+				FString ClassPath;
+				*Archive << ClassPath;
+				BotClassPaths.Add(ClassPath);
+			}
+
+			if (BotClassPaths.IsValidIndex(ClassIndex))
+			{
+				BotSpawn.ClassPath = BotClassPaths[ClassIndex];
+				OutFrame.BotSpawns.Add(BotSpawn);
+			}
+		}
+		else
+		{
+			// Next frame (or end of stream), leave it for the next read
+			Archive->Seek(EventStart);
+			break;
+		}
+	}
+
+	OutFrame.bValid = !Archive->IsError();
+	return OutFrame.bValid;
+}
+
+
+void ASReplayManager::PlaybackFrame()
+{
+	if (!NextFrame.bValid)
+	{
+		Stop();
+
+		if (!FParse::Param(FCommandLine::Get(), TEXT("ReplayNoExit")))
+		{
+			FPlatformMisc::RequestExit(false);
+		}
+		return;
+	}
+
+	FSReplayFrame Frame = MoveTemp(NextFrame);
+
+	if (ReadFrame(NextFrame))
+	{
+		FApp::SetFixedDeltaTime(NextFrame.DeltaSeconds);
+	}
+
+	int32 NextShot = 0;
+	int32 NextAmmoEvent = 0;
+	for (const TPair<uint8, FSReplayPlayerInput>& Input : Frame.Inputs)
+	{
+		const FSReplayShot* Shots = Frame.Shots.GetData() + NextShot;
+		NextShot += Input.Value.NumShots;
+
+		const FSReplayAmmoEvent* AmmoEvents = Frame.AmmoEvents.GetData() + NextAmmoEvent;
+		NextAmmoEvent += Input.Value.NumAmmoEvents;
+
+		APlayerController* PC = GetPlaybackController(Input.Key);
+		ASCharacter* Character = PC ? Cast<ASCharacter>(PC->GetPawn()) : nullptr;
+		if (Character == nullptr)
+		{
+			continue;
+		}
+
+		if (!PlaybackPawns.Contains(Character))
+		{
+			// Make sure recorded movement is consumed by the movement component in this same frame
+			Character->GetMovementComponent()->PrimaryComponentTick.AddPrerequisite(this, PrimaryActorTick);
+			PlaybackPawns.Add(Character);
+		}
+
+		CheckPlaybackShots(Input.Key, Character->GetCurrentWeapon(), Input.Value, Shots, AmmoEvents);
+
+		Character->ApplyReplayInput(Input.Value, Shots);
+	}
+
+	for (const FSReplayBotSpawn& BotSpawn : Frame.BotSpawns)
+	{
+		SpawnRecordedBot(BotSpawn);
+	}
+
+	ExpectedWaveStates.Append(Frame.WaveStates);
+}
+
+
+void ASReplayManager::CheckPlaybackShots(uint8 Slot, const ASWeapon* Weapon, const FSReplayPlayerInput& Input, const FSReplayShot* Shots, const FSReplayAmmoEvent* AmmoEvents)
+{
+	while (PlaybackAmmo.Num() <= Slot)
+	{
+		PlaybackAmmo.Add(INDEX_NONE);
+	}
+
+	int32& Ammo = PlaybackAmmo[Slot];
+	int32 NextAmmoEvent = 0;
+
+	for (int32 i = 0; i <= Input.NumShots; i++)
+	{
+		// Reloads and the like that happened before this shot
+		while (NextAmmoEvent < Input.NumAmmoEvents && AmmoEvents[NextAmmoEvent].NumShotsBefore <= i)
+		{
+			Ammo = AmmoEvents[NextAmmoEvent].Ammo;
+			NextAmmoEvent++;
+		}
+
+		if (i == Input.NumShots)
+		{
+			break;
+		}
+
+		NumPlaybackShots++;
+
+		// A recorded shot always had a round, an empty weapon here means the stream lost an ammo event
+		const bool bOutOfAmmo = Ammo == 0;
+		const bool bOtherSeed = Weapon && Weapon->GetSpreadSeed() != Shots[i].SpreadSeed;
+		if (bOutOfAmmo || bOtherSeed)
+		{
+			ShotMismatches++;
+			UE_LOG(LogTemp, Warning, TEXT("Replay diverged at frame %d: shot %d of player %d %s"), FrameNumber, Shots[i].ShotIndex, Slot,
+				bOutOfAmmo ? TEXT("has no ammo in the stream") : TEXT("was recorded with another spread seed"));
+		}
+
+		if (Ammo > 0)
+		{
+			Ammo--;
+		}
+	}
+}
+
+
+void ASReplayManager::SpawnRecordedBot(const FSReplayBotSpawn& BotSpawn)
+{
+	UClass* BotClass = LoadObject<UClass>(nullptr, *BotSpawn.ClassPath);
+	if (BotClass == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Replay bot class %s could not be loaded"), *BotSpawn.ClassPath);
+		return;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	APawn* Bot = GetWorld()->SpawnActor<APawn>(BotClass, BotSpawn.Location, BotSpawn.Rotation, SpawnParams);
+	if (Bot && Bot->Controller == nullptr)
+	{
+		Bot->SpawnDefaultController();
+	}
+}
+
+
+APlayerController* ASReplayManager::GetPlaybackController(int32 Slot)
+{
+	if (PlaybackControllers.IsValidIndex(Slot) && PlaybackControllers[Slot].IsValid())
+	{
+		return PlaybackControllers[Slot].Get();
+	}
+
+	AGameModeBase* GM = GetWorld()->GetAuthGameMode();
+	if (GM == nullptr)
+	{
+		return nullptr;
+	}
+
+	// Recorded player without a controller yet. Like a client's controller on the server it has no local player,
+	// the game mode gives it a player state and a pawn (and respawns it after that).
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	APlayerController* PC = GetWorld()->SpawnActor<APlayerController>(GM->PlayerControllerClass, SpawnParams);
+	if (PC)
+	{
+		GM->RestartPlayer(PC);
+
+		if (PlaybackControllers.Num() <= Slot)
+		{
+			PlaybackControllers.SetNum(Slot + 1);
+		}
+		PlaybackControllers[Slot] = PC;
+	}
+
+	return PC;
+}
+
+// ------- FRAME TIMES ------- \\
+
+void ASReplayManager::AddFrameTime(double FrameTime)
+{
+	if (FrameTimeHistogram.Num() == 0)
+	{
+		FrameTimeHistogram.SetNumZeroed(NumFrameTimeBuckets);
+	}
+
+	int32 Bucket = FMath::Min((int32)(FrameTime * 1000.0 / FrameTimeBucketMs), NumFrameTimeBuckets - 1);
+	FrameTimeHistogram[Bucket]++;
+}
+
+
+void ASReplayManager::WriteFrameTimeHistogram() const
+{
+	if (FrameTimeHistogram.Num() == 0)
+	{
+		return;
+	}
+
+	FString Csv = TEXT("FrameTimeMs,Frames\n");
+	for (int32 i = 0; i < FrameTimeHistogram.Num(); i++)
+	{
+		Csv += FString::Printf(TEXT("%.1f,%d\n"), i * FrameTimeBucketMs, FrameTimeHistogram[i]);
+	}
+
+	FFileHelper::SaveStringToFile(Csv, *(ReplayFilename + TEXT(".frametimes.csv")));
+}
@@ -8,6 +8,10 @@
 #include "CoopGame.h"
 #include "SHealthComponent.h"
 #include "SWeapon.h"
+#include "SReplayTypes.h"
+#include "SReplayManager.h"
+#include "SLagCompensation.h"
+#include "SPlayerState.h"
 #include "Net/UnrealNetwork.h"
 #include "GameFramework/CharacterMovementComponent.h"
 
@@ -35,6 +39,16 @@ ASCharacter::ASCharacter()
 	//Ignore the collision capsule so weapons hit the mesh and not the capsule
 	GetCapsuleComponent()->SetCollisionResponseToChannel(COLLISION_WEAPON, ECR_Ignore);
 
+	//Hitboxes on the mannequin's bones, shots are traced against these instead of the mesh
+	//The mannequin's bones run along their X axis (towards the parent on the right side), capsules along Z, so they are pitched onto the bone
+	const FRotator AlongBone(90.0f, 0.0f, 0.0f);
+	Hitboxes.Add(FSHitbox::MakeCapsule("Head", "head", 12.0f, 16.0f, 2.0f, SURFACE_FLESHVULNERABLE, FVector(8.0f, 0.0f, 0.0f), AlongBone));
+	Hitboxes.Add(FSHitbox::MakeCapsule("Chest", "spine_03", 20.0f, 28.0f, 1.0f, SURFACE_FLESHDEFAULT, FVector(8.0f, 0.0f, 0.0f), AlongBone));
+	Hitboxes.Add(FSHitbox::MakeCapsule("Pelvis", "pelvis", 18.0f, 22.0f, 1.0f, SURFACE_FLESHDEFAULT, FVector(4.0f, 0.0f, 0.0f), AlongBone));
+	//Thigh and calf, half way down the leg
+	Hitboxes.Add(FSHitbox::MakeCapsule("LeftLeg", "thigh_l", 9.0f, 45.0f, 1.0f, SURFACE_FLESHDEFAULT, FVector(45.0f, 0.0f, 0.0f), AlongBone));
+	Hitboxes.Add(FSHitbox::MakeCapsule("RightLeg", "thigh_r", 9.0f, 45.0f, 1.0f, SURFACE_FLESHDEFAULT, FVector(-45.0f, 0.0f, 0.0f), AlongBone));
+
 //Health Comp
 
 	HealthComp = CreateDefaultSubobject<USHealthComponent>(TEXT("HealthComp"));
@@ -55,8 +69,10 @@ ASCharacter::ASCharacter()
 	DefaultMovementSpeed = 350;
 	SprintingMovementSpeed = 850;
 	CrouchedMovementSpeed = 200;
+	MovementSpeedMultiplier = 1.0f;
 
 	bReloading = false;
+
 }
 
 // Called when the game starts or when spawned
@@ -67,19 +83,8 @@ void ASCharacter::BeginPlay()
 	DefaultFOV = CameraComp->FieldOfView;
 	HealthComp->OnHealthChanged.AddDynamic(this, &ASCharacter::OnHealthChanged);
 
-	if (Role == ROLE_Authority)
-	{
-		// Spawn a default weapon
-		FActorSpawnParameters SpawnParams;
-		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-
-		CurrentWeapon = GetWorld()->SpawnActor<ASWeapon>(StarterWeaponClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
-		if (CurrentWeapon)
-		{
-			CurrentWeapon->SetOwner(this);
-			CurrentWeapon->AttachToComponent(GetMesh(), FAttachmentTransformRules::SnapToTargetNotIncludingScale, WeaponAttachSocketName);
-		}
-	}
+	//Every machine traces shots against the hitboxes
+	ASWorldManager::Get<ASLagCompensation>(this)->RegisterPawn(this, &Hitboxes);
 }
 
 // Called every frame
@@ -119,6 +124,9 @@ void ASCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponen
 	PlayerInputComponent->BindAction("Fire", IE_Pressed, this, &ASCharacter::StartFire);
 	PlayerInputComponent->BindAction("Fire", IE_Released, this, &ASCharacter::StopFire);
 
+	PlayerInputComponent->BindAction("NextWeapon", IE_Pressed, this, &ASCharacter::NextWeapon);
+	PlayerInputComponent->BindAction("PreviousWeapon", IE_Pressed, this, &ASCharacter::PreviousWeapon);
+
 	// CHALLENGE CODE
 	PlayerInputComponent->BindAction("Jump", IE_Pressed, this, &ACharacter::Jump);
 }
@@ -129,12 +137,16 @@ void ASCharacter::MoveForward(float Value)
 {
 	AddMovementInput(GetActorForwardVector() * Value);
 
-	if (Value > 0.0f)
+	//The weapon is stowed between dying and being unpossessed
+	if (CurrentWeapon)
 	{
-		CurrentWeapon->IsMoving = true;
-	}
-	else {
-		CurrentWeapon->IsMoving = false;
+		if (Value > 0.0f)
+		{
+			CurrentWeapon->IsMoving = true;
+		}
+		else {
+			CurrentWeapon->IsMoving = false;
+		}
 	}
 }
 
@@ -143,12 +155,16 @@ void ASCharacter::MoveRight(float Value)
 {
 	AddMovementInput(GetActorRightVector() * Value);
 
-	if (Value > 0.0f)
+	//The weapon is stowed between dying and being unpossessed
+	if (CurrentWeapon)
 	{
-		CurrentWeapon->IsMoving = true;
-	}
-	else {
-		CurrentWeapon->IsMoving = false;
+		if (Value > 0.0f)
+		{
+			CurrentWeapon->IsMoving = true;
+		}
+		else {
+			CurrentWeapon->IsMoving = false;
+		}
 	}
 }
 
@@ -203,27 +219,35 @@ void ASCharacter::EndCrouch()
 
 void ASCharacter::BeginSprint()
 {
-	GetCharacterMovement()->MaxWalkSpeed = SprintingMovementSpeed;
+	GetCharacterMovement()->MaxWalkSpeed = SprintingMovementSpeed * MovementSpeedMultiplier;
 }
 
 
 void ASCharacter::EndSprint()
 {
-	GetCharacterMovement()->MaxWalkSpeed = DefaultMovementSpeed;
+	GetCharacterMovement()->MaxWalkSpeed = DefaultMovementSpeed * MovementSpeedMultiplier;
 }
 
 
 void ASCharacter::BeginZoom()
 {
 	bWantsToZoom = true;
-	CurrentWeapon->IsAiming = true;
+
+	if (CurrentWeapon)
+	{
+		CurrentWeapon->IsAiming = true;
+	}
 }
 
 
 void ASCharacter::EndZoom()
 {
 	bWantsToZoom = false;
-	CurrentWeapon->IsAiming = false;
+
+	if (CurrentWeapon)
+	{
+		CurrentWeapon->IsAiming = false;
+	}
 }
 
 
@@ -245,6 +269,47 @@ void ASCharacter::StopFire()
 }
 
 
+void ASCharacter::SetMovementSpeedMultiplier(float NewMultiplier)
+{
+	NewMultiplier = FMath::Max(NewMultiplier, 0.01f);
+
+	// Rescale whatever speed we are moving at right now (walking or sprinting)
+	UCharacterMovementComponent* MoveComp = GetCharacterMovement();
+	MoveComp->MaxWalkSpeed = MoveComp->MaxWalkSpeed / MovementSpeedMultiplier * NewMultiplier;
+
+	MovementSpeedMultiplier = NewMultiplier;
+}
+
+
+void ASCharacter::AddSpeedBoost(const UObject* Source, float Multiplier)
+{
+	SpeedBoosts.Add(Source, Multiplier);
+	UpdateSpeedBoosts();
+}
+
+
+void ASCharacter::RemoveSpeedBoost(const UObject* Source)
+{
+	//Whatever other boosts are still running keep going
+	if (SpeedBoosts.Remove(Source) > 0)
+	{
+		UpdateSpeedBoosts();
+	}
+}
+
+
+void ASCharacter::UpdateSpeedBoosts()
+{
+	float Product = 1.0f;
+	for (const TPair<const UObject*, float>& Boost : SpeedBoosts)
+	{
+		Product *= Boost.Value;
+	}
+
+	SetMovementSpeedMultiplier(Product);
+}
+
+
 void ASCharacter::Reload()
 {
 	if (CurrentWeapon)
@@ -259,6 +324,47 @@ void ASCharacter::EndReload()
 	bReloading = false;
 }
 
+
+void ASCharacter::NextWeapon()
+{
+	CycleWeapon(1);
+}
+
+
+void ASCharacter::PreviousWeapon()
+{
+	CycleWeapon(-1);
+}
+
+
+void ASCharacter::CycleWeapon(int32 Offset)
+{
+	ASPlayerState* PS = Cast<ASPlayerState>(PlayerState);
+	if (PS == nullptr || PS->GetWeapons().Num() < 2)
+	{
+		return;
+	}
+
+	const int32 NumWeapons = PS->GetWeapons().Num();
+	const int32 CurrentIndex = FMath::Max(PS->GetWeapons().Find(CurrentWeapon), 0);
+	const int32 NewIndex = (CurrentIndex + Offset % NumWeapons + NumWeapons) % NumWeapons;
+
+	//Shots of the old weapon are settled before the server swaps it out
+	if (CurrentWeapon)
+	{
+		CurrentWeapon->StopFire(true);
+	}
+
+	if (Role == ROLE_Authority)
+	{
+		EquipWeapon(NewIndex);
+	}
+	else
+	{
+		ServerEquipWeapon(NewIndex);
+	}
+}
+
 // ------- FUNCTION ------- \\
 
 void ASCharacter::OnHealthChanged(USHealthComponent* OwningHealthComp, float Health, float HealthDelta, const class UDamageType* DamageType,
@@ -269,6 +375,12 @@ void ASCharacter::OnHealthChanged(USHealthComponent* OwningHealthComp, float Hea
 		// Die!
 		bDied = true;
 
+		//The weapons stay with the player for their next pawn
+		if (Role == ROLE_Authority)
+		{
+			StowWeapons();
+		}
+
 		//Stop movement immediately
 		GetMovementComponent()->StopMovementImmediately();
 
@@ -296,8 +408,215 @@ FVector ASCharacter::GetPawnViewLocation() const
 	return Super::GetPawnViewLocation();
 }
 
+
+void ASCharacter::PossessedBy(AController* NewController)
+{
+	Super::PossessedBy(NewController);
+
+	//Players keep their weapons across respawns, everyone else gets a weapon of their own
+	ASPlayerState* PS = Cast<ASPlayerState>(PlayerState);
+	if (PS)
+	{
+		TakeInventory(PS);
+	}
+	else if (CurrentWeapon == nullptr)
+	{
+		// Spawn a default weapon
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+		CurrentWeapon = GetWorld()->SpawnActor<ASWeapon>(StarterWeaponClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
+		if (CurrentWeapon)
+		{
+			CurrentWeapon->SetOwner(this);
+			CurrentWeapon->AttachToComponent(GetMesh(), FAttachmentTransformRules::SnapToTargetNotIncludingScale, WeaponAttachSocketName);
+		}
+	}
+}
+
+
+void ASCharacter::TakeInventory(ASPlayerState* InventoryOwner)
+{
+	if (InventoryOwner->GetWeapons().Num() == 0)
+	{
+		//First pawn of the player this match, the weapons are spawned once and owned by the controller while not in hand
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParams.Owner = GetController();
+
+		TArray<TSubclassOf<ASWeapon>> WeaponClasses;
+		WeaponClasses.Add(StarterWeaponClass);
+		WeaponClasses.Append(InventoryWeaponClasses);
+
+		for (TSubclassOf<ASWeapon> WeaponClass : WeaponClasses)
+		{
+			ASWeapon* Weapon = WeaponClass ? GetWorld()->SpawnActor<ASWeapon>(WeaponClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams) : nullptr;
+			if (Weapon)
+			{
+				Weapon->SetActorHiddenInGame(true);
+				InventoryOwner->AddWeapon(Weapon);
+			}
+		}
+	}
+	else
+	{
+		//A respawn, the weapons come back full like new ones used to
+		for (ASWeapon* Weapon : InventoryOwner->GetWeapons())
+		{
+			if (Weapon)
+			{
+				Weapon->Restock();
+			}
+		}
+	}
+
+	EquipWeapon(InventoryOwner->GetCurrentWeaponIndex());
+}
+
+
+void ASCharacter::EquipWeapon(int32 Index)
+{
+	ASPlayerState* PS = Cast<ASPlayerState>(PlayerState);
+	ASWeapon* NewWeapon = PS ? PS->GetWeapon(Index) : nullptr;
+	if (NewWeapon == nullptr || NewWeapon == CurrentWeapon)
+	{
+		return;
+	}
+
+	HolsterWeapon(CurrentWeapon);
+
+	NewWeapon->SetOwner(this);
+	NewWeapon->AttachToComponent(GetMesh(), FAttachmentTransformRules::SnapToTargetNotIncludingScale, WeaponAttachSocketName);
+	NewWeapon->SetActorHiddenInGame(false);
+	NewWeapon->IsAiming = bWantsToZoom;
+
+	CurrentWeapon = NewWeapon;
+
+	PS->SetCurrentWeaponIndex(Index);
+
+	//Replays follow the ammo of the weapon in hand
+	ASReplayManager* ReplayManager = ASWorldManager::Get<ASReplayManager>(this, false);
+	if (ReplayManager)
+	{
+		ReplayManager->RecordAmmoEvent(this, ESReplayAmmoEvent::Equip, NewWeapon->CurrentAmmo);
+	}
+}
+
+
+void ASCharacter::StowWeapons()
+{
+	ASPlayerState* PS = Cast<ASPlayerState>(PlayerState);
+	if (PS == nullptr || CurrentWeapon == nullptr)
+	{
+		return;
+	}
+
+	HolsterWeapon(CurrentWeapon);
+
+	CurrentWeapon = nullptr;
+}
+
+
+void ASCharacter::HolsterWeapon(ASWeapon* Weapon)
+{
+	if (Weapon == nullptr)
+	{
+		return;
+	}
+
+	//Whatever the fire mode, a burst must not carry on from the holster
+	Weapon->StopFire(true);
+	Weapon->DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+	Weapon->SetActorHiddenInGame(true);
+
+	//The controller outlives the pawn and keeps the weapon relevant to its owner
+	Weapon->SetOwner(GetController());
+}
+
+// ------- REPLAY ------- \\
+
+void ASCharacter::BuildReplayInput(FSReplayPlayerInput& OutInput)
+{
+	FVector MoveDirection = GetCharacterMovement()->GetCurrentAcceleration().GetSafeNormal2D();
+	OutInput.MoveX = (int8)FMath::RoundToInt(MoveDirection.X * 127.0f);
+	OutInput.MoveY = (int8)FMath::RoundToInt(MoveDirection.Y * 127.0f);
+
+	FRotator ControlRotation = GetControlRotation();
+	OutInput.Pitch = FRotator::CompressAxisToShort(ControlRotation.Pitch);
+	OutInput.Yaw = FRotator::CompressAxisToShort(ControlRotation.Yaw);
+
+	OutInput.Flags = 0;
+	OutInput.Flags |= bIsCrouched ? REPLAYINPUT_Crouched : 0;
+	OutInput.Flags |= bPressedJump ? REPLAYINPUT_Jumping : 0;
+
+	if (CurrentWeapon)
+	{
+		OutInput.Flags |= CurrentWeapon->IsAiming ? REPLAYINPUT_Aiming : 0;
+		OutInput.Flags |= CurrentWeapon->IsMoving ? REPLAYINPUT_Moving : 0;
+	}
+}
+
+
+void ASCharacter::ApplyReplayInput(const FSReplayPlayerInput& Input, const FSReplayShot* Shots)
+{
+	if (Input.MoveX != 0 || Input.MoveY != 0)
+	{
+		AddMovementInput(FVector(Input.MoveX, Input.MoveY, 0.0f) / 127.0f);
+	}
+
+	if (Controller)
+	{
+		Controller->SetControlRotation(FRotator(FRotator::DecompressAxisFromShort(Input.Pitch), FRotator::DecompressAxisFromShort(Input.Yaw), 0.0f));
+	}
+
+	bool bWantsToCrouch = (Input.Flags & REPLAYINPUT_Crouched) != 0;
+	if (bWantsToCrouch && !bIsCrouched)
+	{
+		Crouch();
+	}
+	else if (!bWantsToCrouch && bIsCrouched)
+	{
+		UnCrouch();
+	}
+
+	if (Input.Flags & REPLAYINPUT_Jumping)
+	{
+		Jump();
+	}
+	else
+	{
+		StopJumping();
+	}
+
+	bWantsToZoom = (Input.Flags & REPLAYINPUT_Aiming) != 0;
+
+	if (CurrentWeapon)
+	{
+		CurrentWeapon->IsAiming = bWantsToZoom;
+		CurrentWeapon->IsMoving = (Input.Flags & REPLAYINPUT_Moving) != 0;
+
+		//Recorded aim, eye point and timing, not wherever the pawn looks now
+		for (int32 i = 0; i < Input.NumShots; i++)
+		{
+			CurrentWeapon->FireReplayShot(Shots[i]);
+		}
+	}
+}
+
 // ------- ONLINE ------- \\
 
+void ASCharacter::ServerEquipWeapon_Implementation(int32 Index)
+{
+	EquipWeapon(Index);
+}
+
+
+bool ASCharacter::ServerEquipWeapon_Validate(int32 Index)
+{
+	return true;
+}
+
+
 void ASCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SEffectScheduler.h"
+
+
+ASEffectScheduler::ASEffectScheduler()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
+	CurrentTick = 0;
+	TimeAccumulator = 0.0f;
+	SlotDuration = 1.0f / 60.0f;
+	NextSerial = 1;
+}
+
+
+int32 ASEffectScheduler::SecondsToTicks(float Seconds) const
+{
+	return FMath::Max(FMath::RoundToInt(Seconds / SlotDuration), 1);
+}
+
+
+FSEffectHandle ASEffectScheduler::StartEffect(const FSEffectTickDelegate& OnTick, float Interval, int32 NumTicks, float FirstDelay)
+{
+	FEffect Effect;
+	Effect.OnTick = OnTick;
+	Effect.IntervalTicks = SecondsToTicks(Interval);
+	Effect.RemainingTicks = NumTicks > 0 ? NumTicks : INDEX_NONE;
+	Effect.NextTick = CurrentTick + (FirstDelay < 0.0f ? Effect.IntervalTicks : SecondsToTicks(FirstDelay));
+	Effect.Serial = NextSerial++;
+	Effect.bActive = true;
+
+	FSEffectHandle Handle;
+	Handle.Index = Effects.Add(Effect);
+	Handle.Serial = Effect.Serial;
+
+	Slots[Effect.NextTick % NumSlots].Add(Handle.Index);
+
+	if (!IsActorTickEnabled())
+	{
+		SetActorTickEnabled(true);
+	}
+
+	return Handle;
+}
+
+
+void ASEffectScheduler::StopEffect(FSEffectHandle& Handle)
+{
+	if (IsEffectActive(Handle))
+	{
+		// Removed when its slot comes up
+		Effects[Handle.Index].bActive = false;
+	}
+
+	Handle.Invalidate();
+}
+
+
+bool ASEffectScheduler::IsEffectActive(const FSEffectHandle& Handle) const
+{
+	return Handle.IsValid() && Effects.IsValidIndex(Handle.Index) && Effects[Handle.Index].Serial == Handle.Serial && Effects[Handle.Index].bActive;
+}
+
+
+void ASEffectScheduler::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	TimeAccumulator += DeltaSeconds;
+
+	while (TimeAccumulator >= SlotDuration)
+	{
+		TimeAccumulator -= SlotDuration;
+		CurrentTick++;
+
+		ProcessSlot(CurrentTick % NumSlots);
+	}
+
+	if (Effects.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+		TimeAccumulator = 0.0f;
+	}
+}
+
+
+void ASEffectScheduler::ProcessSlot(int32 SlotIndex)
+{
+	if (Slots[SlotIndex].Num() == 0)
+	{
+		return;
+	}
+
+	// Effects may be rescheduled into this same slot while we process it
+	Swap(SlotBeingProcessed, Slots[SlotIndex]);
+
+	for (int32 EffectIndex : SlotBeingProcessed)
+	{
+		if (!Effects[EffectIndex].bActive)
+		{
+			Effects.RemoveAt(EffectIndex);
+			continue;
+		}
+
+		if (Effects[EffectIndex].NextTick > CurrentTick)
+		{
+			// Due in a later revolution of the wheel
+			Slots[SlotIndex].Add(EffectIndex);
+			continue;
+		}
+
+		bool bBound = Effects[EffectIndex].OnTick.ExecuteIfBound();
+
+		// Ticking may have started new effects, don't hold on to references across the call
+		FEffect& Effect = Effects[EffectIndex];
+
+		if (!bBound || !Effect.bActive || (Effect.RemainingTicks != INDEX_NONE && --Effect.RemainingTicks <= 0))
+		{
+			Effects.RemoveAt(EffectIndex);
+			continue;
+		}
+
+		Effect.NextTick += Effect.IntervalTicks;
+		Slots[Effect.NextTick % NumSlots].Add(EffectIndex);
+	}
+
+	SlotBeingProcessed.Reset();
+}
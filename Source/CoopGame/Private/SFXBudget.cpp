@@ -0,0 +1,337 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SFXBudget.h"
+#include "CoopGame.h"
+#include "SFXPool.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+
+static int32 FXBudgetEnabled = 1;
+FAutoConsoleVariableRef CVARFXBudgetEnabled(
+	TEXT("COOP.FXBudget"),
+	FXBudgetEnabled,
+	TEXT("Rank cosmetic effects and cap how many play at once, 0 plays every effect right away"),
+	ECVF_Default);
+
+static float FXBudgetScale = 1.0f;
+FAutoConsoleVariableRef CVARFXBudgetScale(
+	TEXT("COOP.FXBudget.Scale"),
+	FXBudgetScale,
+	TEXT("Scales the number of emitters each effect category may play at once"),
+	ECVF_Scalability);
+
+static float FXBudgetDowngradeSignificance = 0.25f;
+FAutoConsoleVariableRef CVARFXBudgetDowngradeSignificance(
+	TEXT("COOP.FXBudget.DowngradeSignificance"),
+	FXBudgetDowngradeSignificance,
+	TEXT("Effects less significant than this play at their lowest detail level (1 is an on-screen muzzle flash next to the camera)"),
+	ECVF_Default);
+
+// Per ESFXCategory: importance, distance past which the effect is never played, and emitters playing at once
+static const float CategoryWeights[] = { 1.0f, 0.75f, 1.0f, 4.0f };
+static const float CategoryMaxDistances[] = { 5000.0f, 8000.0f, 6000.0f, 20000.0f };
+static const int32 CategoryMaxPlaying[] = { 16, 24, 32, 8 };
+static_assert(ARRAY_COUNT(CategoryMaxPlaying) == (int32)ESFXCategory::MAX, "One entry per effect category");
+
+// Effects this close always count as on screen, they might fill it
+static const float OnScreenRadius = 300.0f;
+
+// Significance of effects behind the camera
+static const float OffScreenScale = 0.1f;
+
+DECLARE_CYCLE_STAT(TEXT("FX Budget"), STAT_FXBudget, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("FX Requests"), STAT_FXRequests, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("FX Played"), STAT_FXPlayed, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("FX Downgraded"), STAT_FXDowngraded, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("FX Dropped"), STAT_FXDropped, STATGROUP_CoopGame);
+
+
+static void PrintFXBudgetStats(const TArray<FString>& Args, UWorld* World)
+{
+	ASFXBudget* Budget = ASWorldManager::Get<ASFXBudget>(World, false);
+	if (Budget == nullptr)
+	{
+		UE_LOG(LogTemp, Log, TEXT("COOP.FXBudget.Stats: no effects requested in this world"));
+		return;
+	}
+
+	const UEnum* CategoryEnum = FindObject<UEnum>(ANY_PACKAGE, TEXT("ESFXCategory"));
+	for (int32 i = 0; i < (int32)ESFXCategory::MAX; i++)
+	{
+		UE_LOG(LogTemp, Log, TEXT("COOP.FXBudget.Stats: %-10s requested %6d, played %6d, downgraded %6d, dropped %6d"),
+			CategoryEnum ? *CategoryEnum->GetNameStringByIndex(i) : *FString::FromInt(i), Budget->NumRequested[i], Budget->NumPlayed[i], Budget->NumDowngraded[i], Budget->NumDropped[i]);
+	}
+
+	if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+	{
+		Budget->ResetCounters();
+	}
+}
+
+FAutoConsoleCommandWithWorldAndArgs CCmdFXBudgetStats(
+	TEXT("COOP.FXBudget.Stats"),
+	TEXT("Log how many effects of each category were played, downgraded and dropped. Args: [reset]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&PrintFXBudgetStats));
+
+
+ASFXBudget::ASFXBudget()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	// After the cameras moved this frame
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
+	ResetCounters();
+}
+
+
+void ASFXBudget::ResetCounters()
+{
+	for (int32 i = 0; i < (int32)ESFXCategory::MAX; i++)
+	{
+		NumRequested[i] = 0;
+		NumPlayed[i] = 0;
+		NumDowngraded[i] = 0;
+		NumDropped[i] = 0;
+	}
+}
+
+
+void ASFXBudget::RequestEmitterAtLocation(const UObject* WorldContextObject, UParticleSystem* Template, ESFXCategory Category, const FVector& Location,
+	const FRotator& Rotation, FName ParameterName, const FVector& ParameterValue)
+{
+	ASFXBudget* Budget = Template && ASFXPool::CanPlayEffects(WorldContextObject) ? Get<ASFXBudget>(WorldContextObject) : nullptr;
+	if (Budget == nullptr)
+	{
+		return;
+	}
+
+	FRequest Request;
+	Request.Template = Template;
+	Request.Category = Category;
+	Request.bAttached = false;
+	Request.Location = Location;
+	Request.Rotation = Rotation;
+	Request.ParameterName = ParameterName;
+	Request.ParameterValue = ParameterValue;
+
+	Budget->AddRequest(Request);
+}
+
+
+void ASFXBudget::RequestEmitterAttached(UParticleSystem* Template, ESFXCategory Category, USceneComponent* AttachToComponent, FName AttachPointName)
+{
+	ASFXBudget* Budget = Template && AttachToComponent && ASFXPool::CanPlayEffects(AttachToComponent) ? Get<ASFXBudget>(AttachToComponent) : nullptr;
+	if (Budget == nullptr)
+	{
+		return;
+	}
+
+	FRequest Request;
+	Request.Template = Template;
+	Request.Category = Category;
+	Request.bAttached = true;
+	Request.AttachToComponent = AttachToComponent;
+	Request.AttachPointName = AttachPointName;
+	Request.Location = AttachToComponent->GetSocketLocation(AttachPointName);
+	Request.Rotation = FRotator::ZeroRotator;
+	Request.ParameterName = NAME_None;
+	Request.ParameterValue = FVector::ZeroVector;
+
+	Budget->AddRequest(Request);
+}
+
+
+void ASFXBudget::AddRequest(FRequest& Request)
+{
+	INC_DWORD_STAT(STAT_FXRequests);
+	NumRequested[(int32)Request.Category]++;
+
+	if (FXBudgetEnabled == 0)
+	{
+		PlayRequest(Request, false);
+		return;
+	}
+
+	if (PendingRequests.Num() >= MaxPendingRequests)
+	{
+		INC_DWORD_STAT(STAT_FXDropped);
+		NumDropped[(int32)Request.Category]++;
+		return;
+	}
+
+	Request.Significance = 0.0f;
+	PendingRequests.Add(Request);
+
+	if (!IsActorTickEnabled())
+	{
+		SetActorTickEnabled(true);
+	}
+}
+
+
+float ASFXBudget::GetSignificance(ESFXCategory Category, const FVector& Location, const FVector& ViewLocation, const FVector& ViewDirection, float ViewHalfFOV)
+{
+	const FVector ToEffect = Location - ViewLocation;
+	const float Distance = ToEffect.Size();
+	if (Distance > CategoryMaxDistances[(int32)Category])
+	{
+		return 0.0f;
+	}
+
+	const bool bOnScreen = Distance < OnScreenRadius || FVector::DotProduct(ToEffect / Distance, ViewDirection) >= FMath::Cos(ViewHalfFOV);
+
+	// Falls off with distance, halved at 10 meters
+	return CategoryWeights[(int32)Category] * (bOnScreen ? 1.0f : OffScreenScale) / (1.0f + Distance / 1000.0f);
+}
+
+
+bool ASFXBudget::GetView(FVector& OutLocation, FVector& OutDirection, float& OutHalfFOV) const
+{
+	APlayerController* PC = GEngine->GetFirstLocalPlayerController(GetWorld());
+	if (PC == nullptr || PC->PlayerCameraManager == nullptr)
+	{
+		return false;
+	}
+
+	OutLocation = PC->PlayerCameraManager->GetCameraLocation();
+	OutDirection = PC->PlayerCameraManager->GetCameraRotation().Vector();
+	// Horizontal field of view, a little wider so effects at the edges still count
+	OutHalfFOV = FMath::DegreesToRadians(FMath::Min(PC->PlayerCameraManager->GetFOVAngle() * 0.5f + 10.0f, 180.0f));
+	return true;
+}
+
+
+void ASFXBudget::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	ProcessRequests();
+
+	if (PendingRequests.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+
+void ASFXBudget::ProcessRequests()
+{
+	SCOPE_CYCLE_COUNTER(STAT_FXBudget);
+
+	// Emitters that finished (or were destroyed) free up their category
+	int32 NumPlaying[(int32)ESFXCategory::MAX] = {};
+	for (int32 i = PlayingEmitters.Num() - 1; i >= 0; i--)
+	{
+		UParticleSystemComponent* PSC = PlayingEmitters[i].Component.Get();
+		if (PSC && PSC->IsActive())
+		{
+			NumPlaying[(int32)PlayingEmitters[i].Category]++;
+		}
+		else
+		{
+			PlayingEmitters.RemoveAtSwap(i, 1, false);
+		}
+	}
+
+	FVector ViewLocation;
+	FVector ViewDirection;
+	float ViewHalfFOV;
+	const bool bHasView = GetView(ViewLocation, ViewDirection, ViewHalfFOV);
+
+	for (FRequest& Request : PendingRequests)
+	{
+		// Attached effects are ranked where their socket is now
+		if (USceneComponent* AttachTo = Request.AttachToComponent.Get())
+		{
+			Request.Location = AttachTo->GetSocketLocation(Request.AttachPointName);
+		}
+
+		// Nobody is watching on machines without a local player
+		Request.Significance = bHasView ? GetSignificance(Request.Category, Request.Location, ViewLocation, ViewDirection, ViewHalfFOV) : 0.0f;
+	}
+
+	PendingRequests.Sort([](const FRequest& A, const FRequest& B)
+	{
+		return A.Significance > B.Significance;
+	});
+
+	for (const FRequest& Request : PendingRequests)
+	{
+		const int32 Category = (int32)Request.Category;
+		const int32 MaxPlaying = FMath::RoundToInt(CategoryMaxPlaying[Category] * FXBudgetScale);
+
+		const bool bValid = Request.Template.IsValid() && (!Request.bAttached || Request.AttachToComponent.IsValid());
+		if (!bValid || Request.Significance <= 0.0f || NumPlaying[Category] >= MaxPlaying)
+		{
+			INC_DWORD_STAT(STAT_FXDropped);
+			NumDropped[Category]++;
+			continue;
+		}
+
+		PlayRequest(Request, Request.Significance < FXBudgetDowngradeSignificance);
+		NumPlaying[Category]++;
+	}
+
+	PendingRequests.Reset();
+}
+
+
+void ASFXBudget::PlayRequest(const FRequest& Request, bool bDowngrade)
+{
+	UParticleSystem* Template = Request.Template.Get();
+	if (Template == nullptr)
+	{
+		return;
+	}
+
+	USceneComponent* AttachTo = Request.AttachToComponent.Get();
+	if (Request.bAttached && AttachTo == nullptr)
+	{
+		return;
+	}
+
+	UParticleSystemComponent* PSC = AttachTo ? ASFXPool::SpawnEmitterAttached(Template, AttachTo, Request.AttachPointName)
+		: ASFXPool::SpawnEmitterAtLocation(this, Template, Request.Location, Request.Rotation);
+	if (PSC == nullptr)
+	{
+		return;
+	}
+
+	if (Request.ParameterName != NAME_None)
+	{
+		PSC->SetVectorParameter(Request.ParameterName, Request.ParameterValue);
+	}
+
+	// Pooled components keep their settings, so always set the detail level
+	const int32 NumLODs = Template->LODDistances.Num();
+	if (bDowngrade && NumLODs > 1)
+	{
+		INC_DWORD_STAT(STAT_FXDowngraded);
+		NumDowngraded[(int32)Request.Category]++;
+
+		PSC->bOverrideLODMethod = true;
+		PSC->LODMethod = PARTICLESYSTEMLODMETHOD_DirectSet;
+		PSC->SetLODLevel(NumLODs - 1);
+	}
+	else
+	{
+		PSC->bOverrideLODMethod = false;
+	}
+
+	INC_DWORD_STAT(STAT_FXPlayed);
+	NumPlayed[(int32)Request.Category]++;
+
+	// Without the budget nothing is capped, so nothing needs tracking
+	if (FXBudgetEnabled != 0)
+	{
+		FPlayingEmitter Playing;
+		Playing.Component = PSC;
+		Playing.Category = Request.Category;
+		PlayingEmitters.Add(Playing);
+	}
+}
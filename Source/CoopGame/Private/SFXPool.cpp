@@ -0,0 +1,171 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SFXPool.h"
+#include "CoopGame.h"
+#include "Kismet/GameplayStatics.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+
+static int32 FXPoolMaxPerSystem = 32;
+FAutoConsoleVariableRef CVARFXPoolMaxPerSystem(
+	TEXT("COOP.FXPoolMaxPerSystem"),
+	FXPoolMaxPerSystem,
+	TEXT("Most pooled components per particle system, effects past that spawn a throwaway component"),
+	ECVF_Default);
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("FX Allocations Avoided"), STAT_FXPoolReuses, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("FX Pool Allocations"), STAT_FXPoolAllocations, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("FX Pool Overflows"), STAT_FXPoolOverflows, STATGROUP_CoopGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("FX Pooled Components"), STAT_FXPooledComponents, STATGROUP_CoopGame);
+
+
+UParticleSystemComponent* ASFXPool::SpawnEmitterAtLocation(const UObject* WorldContextObject, UParticleSystem* Template, const FVector& Location, const FRotator& Rotation)
+{
+	if (Template == nullptr || !CanPlayEffects(WorldContextObject))
+	{
+		return nullptr;
+	}
+
+	ASFXPool* Pool = Get<ASFXPool>(WorldContextObject);
+	UParticleSystemComponent* PSC = Pool ? Pool->Acquire(Template) : nullptr;
+	if (PSC == nullptr)
+	{
+		INC_DWORD_STAT(STAT_FXPoolOverflows);
+		return UGameplayStatics::SpawnEmitterAtLocation(WorldContextObject, Template, Location, Rotation);
+	}
+
+	PSC->SetWorldLocationAndRotation(Location, Rotation);
+	PSC->ActivateSystem(true);
+	return PSC;
+}
+
+
+UParticleSystemComponent* ASFXPool::SpawnEmitterAttached(UParticleSystem* Template, USceneComponent* AttachToComponent, FName AttachPointName)
+{
+	if (Template == nullptr || AttachToComponent == nullptr || !CanPlayEffects(AttachToComponent))
+	{
+		return nullptr;
+	}
+
+	ASFXPool* Pool = Get<ASFXPool>(AttachToComponent);
+	UParticleSystemComponent* PSC = Pool ? Pool->Acquire(Template) : nullptr;
+	if (PSC == nullptr)
+	{
+		INC_DWORD_STAT(STAT_FXPoolOverflows);
+		return UGameplayStatics::SpawnEmitterAttached(Template, AttachToComponent, AttachPointName, FVector::ZeroVector, FRotator::ZeroRotator, EAttachLocation::SnapToTargetIncludingScale);
+	}
+
+	PSC->AttachToComponent(AttachToComponent, FAttachmentTransformRules::SnapToTargetNotIncludingScale, AttachPointName);
+	PSC->ActivateSystem(true);
+	return PSC;
+}
+
+
+void ASFXPool::Prewarm(const UObject* WorldContextObject, UParticleSystem* Template, int32 Count)
+{
+	ASFXPool* Pool = Template && CanPlayEffects(WorldContextObject) ? Get<ASFXPool>(WorldContextObject) : nullptr;
+	if (Pool == nullptr)
+	{
+		return;
+	}
+
+	FSFXPoolList& List = Pool->Pools.FindOrAdd(Template);
+
+	const int32 NumToCreate = FMath::Min(Count, FXPoolMaxPerSystem) - List.NumComponents;
+	for (int32 i = 0; i < NumToCreate; i++)
+	{
+		List.Free.Add(Pool->CreateComponent(Template));
+		List.NumComponents++;
+	}
+}
+
+
+bool ASFXPool::CanPlayEffects(const UObject* WorldContextObject)
+{
+#if UE_SERVER
+	return false;
+#else
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	return World && World->GetNetMode() != NM_DedicatedServer;
+#endif
+}
+
+
+UParticleSystemComponent* ASFXPool::Acquire(UParticleSystem* Template)
+{
+	FSFXPoolList& List = Pools.FindOrAdd(Template);
+
+	while (List.Free.Num() > 0)
+	{
+		UParticleSystemComponent* PSC = List.Free.Pop(false);
+		if (PSC && !PSC->IsPendingKill())
+		{
+			INC_DWORD_STAT(STAT_FXPoolReuses);
+			return PSC;
+		}
+
+		// Destroyed from outside, e.g. along with an actor it was attached to
+		List.NumComponents--;
+		DEC_DWORD_STAT(STAT_FXPooledComponents);
+	}
+
+	if (List.NumComponents >= FXPoolMaxPerSystem)
+	{
+		return nullptr;
+	}
+
+	List.NumComponents++;
+	return CreateComponent(Template);
+}
+
+
+UParticleSystemComponent* ASFXPool::CreateComponent(UParticleSystem* Template)
+{
+	INC_DWORD_STAT(STAT_FXPoolAllocations);
+	INC_DWORD_STAT(STAT_FXPooledComponents);
+
+	UParticleSystemComponent* PSC = NewObject<UParticleSystemComponent>(this, NAME_None, RF_Transient);
+	PSC->bAutoActivate = false;
+	PSC->bAutoDestroy = false;
+	PSC->bAllowAnyoneToDestroyMe = true;
+	PSC->SecondsBeforeInactive = 0.0f;
+	PSC->SetTemplate(Template);
+	PSC->OnSystemFinished.AddDynamic(this, &ASFXPool::OnSystemFinished);
+	PSC->RegisterComponent();
+	return PSC;
+}
+
+
+void ASFXPool::OnSystemFinished(UParticleSystemComponent* PSystem)
+{
+	FSFXPoolList* List = Pools.Find(PSystem->Template);
+	if (List == nullptr || PSystem->IsPendingKill())
+	{
+		return;
+	}
+
+	if (PSystem->GetAttachParent())
+	{
+		PSystem->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+	}
+
+	// Parameters like tracer targets belong to the last use
+	PSystem->InstanceParameters.Reset();
+
+	List->Free.Add(PSystem);
+}
+
+
+void ASFXPool::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for (const TPair<UParticleSystem*, FSFXPoolList>& Pair : Pools)
+	{
+		DEC_DWORD_STAT_BY(STAT_FXPooledComponents, Pair.Value.NumComponents);
+	}
+
+	Pools.Empty();
+
+	Super::EndPlay(EndPlayReason);
+}
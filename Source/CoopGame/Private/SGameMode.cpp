@@ -4,6 +4,8 @@
 #include "SHealthComponent.h"
 #include "SGameState.h"
 #include "SPlayerState.h"
+#include "SReplayManager.h"
+#include "SCombatTelemetry.h"
 #include "TimerManager.h"
 
 
@@ -69,7 +71,7 @@ void ASGameMode::CheckWaveState()
 			continue;
 		}
 
-		USHealthComponent* HealthComp = Cast<USHealthComponent>(TestPawn->GetComponentByClass(USHealthComponent::StaticClass()));
+		USHealthComponent* HealthComp = USHealthComponent::FindHealthComponent(TestPawn);
 		if (HealthComp && HealthComp->GetHealth() > 0.0f)
 		{
 			bIsAnyBotAlive = true;
@@ -94,7 +96,7 @@ void ASGameMode::CheckAnyPlayerAlive()
 		if (PC && PC->GetPawn())
 		{
 			APawn* MyPawn = PC->GetPawn();
-			USHealthComponent* HealthComp = Cast<USHealthComponent>(MyPawn->GetComponentByClass(USHealthComponent::StaticClass()));
+			USHealthComponent* HealthComp = USHealthComponent::FindHealthComponent(MyPawn);
 			if (ensure(HealthComp) && HealthComp->GetHealth() > 0.0f)
 			{
 				// A player is still alive.
@@ -127,6 +129,14 @@ void ASGameMode::SetWaveState(EWaveState NewState)
 	{
 		GS->SetWaveState(NewState);
 	}
+
+	FSCombatTelemetry::Record(ESTelemetryEvent::WaveState, GameState, nullptr, (float)NewState, (float)WaveCount);
+
+	ASReplayManager* ReplayManager = ASWorldManager::Get<ASReplayManager>(this, false);
+	if (ReplayManager)
+	{
+		ReplayManager->NotifyWaveState(NewState);
+	}
 }
 
 
@@ -147,6 +157,9 @@ void ASGameMode::StartPlay()
 {
 	Super::StartPlay();
 
+	// Record or play back a match when requested on the command line
+	ASReplayManager::StartFromCommandLine(this);
+
 	PrepareForNextWave();
 }
 
@@ -161,7 +174,11 @@ void ASGameMode::Tick(float DeltaSeconds)
 
 void ASGameMode::SpawnBotTimerElapsed()
 {
-	SpawnNewBot();
+	// During replay playback the recorded bots are spawned by the replay manager instead
+	if (!ASReplayManager::IsPlayingBack(this))
+	{
+		SpawnNewBot();
+	}
 
 	NrOfBotsToSpawn--;
 
@@ -1,9 +1,18 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "SGameState.h"
+#include "SLoadTestBot.h"
+#include "SLoadTestReporter.h"
 #include "Net/UnrealNetwork.h"
 
 
+void ASGameState::BeginPlay()
+{
+	Super::BeginPlay();
+
+	ASLoadTestBot::StartFromCommandLine(this);
+	ASLoadTestReporter::StartFromCommandLine(this);
+}
 
 
 void ASGameState::OnRep_WaveState(EWaveState OldState)
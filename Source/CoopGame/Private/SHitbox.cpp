@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SHitbox.h"
+#include "Components/SkeletalMeshComponent.h"
+
+
+FSHitbox::FSHitbox()
+	: Shape(ESHitboxShape::Capsule), Offset(FVector::ZeroVector), Rotation(FRotator::ZeroRotator), Radius(10.0f), HalfHeight(10.0f),
+	BoxExtent(10.0f), DamageMultiplier(1.0f), SurfaceType(SurfaceType_Default)
+{
+}
+
+
+FSHitbox FSHitbox::MakeCapsule(FName InRegion, FName InBoneName, float InRadius, float InHalfHeight, float InDamageMultiplier, EPhysicalSurface InSurfaceType,
+	const FVector& InOffset, const FRotator& InRotation)
+{
+	FSHitbox Hitbox;
+	Hitbox.Region = InRegion;
+	Hitbox.Shape = ESHitboxShape::Capsule;
+	Hitbox.BoneName = InBoneName;
+	Hitbox.Offset = InOffset;
+	Hitbox.Rotation = InRotation;
+	Hitbox.Radius = InRadius;
+	Hitbox.HalfHeight = FMath::Max(InHalfHeight, InRadius);
+	Hitbox.DamageMultiplier = InDamageMultiplier;
+	Hitbox.SurfaceType = InSurfaceType;
+	return Hitbox;
+}
+
+
+FSHitbox FSHitbox::MakeBox(FName InRegion, FName InBoneName, const FVector& InBoxExtent, float InDamageMultiplier, EPhysicalSurface InSurfaceType)
+{
+	FSHitbox Hitbox;
+	Hitbox.Region = InRegion;
+	Hitbox.Shape = ESHitboxShape::Box;
+	Hitbox.BoneName = InBoneName;
+	Hitbox.BoxExtent = InBoxExtent;
+	Hitbox.DamageMultiplier = InDamageMultiplier;
+	Hitbox.SurfaceType = InSurfaceType;
+	return Hitbox;
+}
+
+
+/* Distance at which a ray enters a sphere, false if it misses or starts inside */
+static bool RaycastSphere(const FVector& Start, const FVector& Direction, const FVector& Center, float Radius, float& OutDistance)
+{
+	const FVector ToStart = Start - Center;
+	const float B = FVector::DotProduct(ToStart, Direction);
+	const float C = ToStart.SizeSquared() - Radius * Radius;
+	const float Discriminant = B * B - C;
+	if (C <= 0.0f || Discriminant < 0.0f)
+	{
+		return false;
+	}
+
+	OutDistance = -B - FMath::Sqrt(Discriminant);
+	return OutDistance >= 0.0f;
+}
+
+
+bool FSHitbox::Raycast(const FTransform& HitboxToWorld, const FVector& Start, const FVector& Direction, float MaxDistance, float& OutDistance, FVector& OutNormal) const
+{
+	// Everything in the hitbox's own space, hitboxes are never scaled
+	const FVector LocalStart = HitboxToWorld.InverseTransformPositionNoScale(Start);
+	const FVector LocalDirection = HitboxToWorld.InverseTransformVectorNoScale(Direction);
+
+	if (Shape == ESHitboxShape::Box)
+	{
+		FVector HitLocation;
+		FVector HitNormal;
+		float HitTime;
+		const FVector LocalEnd = LocalStart + LocalDirection * MaxDistance;
+		if (!FMath::LineExtentBoxIntersection(FBox(-BoxExtent, BoxExtent), LocalStart, LocalEnd, FVector::ZeroVector, HitLocation, HitNormal, HitTime))
+		{
+			return false;
+		}
+
+		OutDistance = HitTime * MaxDistance;
+		OutNormal = HitboxToWorld.TransformVectorNoScale(HitNormal);
+		return true;
+	}
+
+	// A capsule is a cylinder between two spheres, take the closest entry of the three
+	const float SegmentHalfLength = FMath::Max(HalfHeight - Radius, 0.0f);
+	const FVector Top(0.0f, 0.0f, SegmentHalfLength);
+	const FVector Bottom(0.0f, 0.0f, -SegmentHalfLength);
+
+	float BestDistance = MaxDistance;
+	bool bHit = false;
+
+	float Distance;
+	if (RaycastSphere(LocalStart, LocalDirection, Top, Radius, Distance) && Distance < BestDistance)
+	{
+		BestDistance = Distance;
+		bHit = true;
+	}
+
+	if (SegmentHalfLength > 0.0f && RaycastSphere(LocalStart, LocalDirection, Bottom, Radius, Distance) && Distance < BestDistance)
+	{
+		BestDistance = Distance;
+		bHit = true;
+	}
+
+	// Cylinder along Z, only where it lies between the two spheres
+	const float A = LocalDirection.X * LocalDirection.X + LocalDirection.Y * LocalDirection.Y;
+	if (A > KINDA_SMALL_NUMBER)
+	{
+		const float B = LocalStart.X * LocalDirection.X + LocalStart.Y * LocalDirection.Y;
+		const float C = LocalStart.X * LocalStart.X + LocalStart.Y * LocalStart.Y - Radius * Radius;
+		const float Discriminant = B * B - A * C;
+		if (C > 0.0f && Discriminant >= 0.0f)
+		{
+			Distance = (-B - FMath::Sqrt(Discriminant)) / A;
+			const float HitZ = LocalStart.Z + LocalDirection.Z * Distance;
+			if (Distance >= 0.0f && Distance < BestDistance && FMath::Abs(HitZ) <= SegmentHalfLength)
+			{
+				BestDistance = Distance;
+				bHit = true;
+			}
+		}
+	}
+
+	if (!bHit)
+	{
+		return false;
+	}
+
+	// Normal points away from the closest point on the capsule's segment
+	const FVector LocalHit = LocalStart + LocalDirection * BestDistance;
+	const FVector SegmentPoint(0.0f, 0.0f, FMath::Clamp(LocalHit.Z, -SegmentHalfLength, SegmentHalfLength));
+
+	OutDistance = BestDistance;
+	OutNormal = HitboxToWorld.TransformVectorNoScale((LocalHit - SegmentPoint).GetSafeNormal());
+	return true;
+}
+
+
+bool FSHitbox::LineTraceHitboxes(const TArray<FSHitbox>& Hitboxes, AActor* Actor, const FTransform& ActorTransform, const USkeletalMeshComponent* Mesh, const FVector& Start, const FVector& End, FHitResult& OutHit)
+{
+	const float MaxDistance = (End - Start).Size();
+	const FVector Direction = (End - Start).GetSafeNormal();
+
+	// Bone poses relative to the actor are the current ones, only the actor itself is rewound
+	const FTransform RigidActorTransform(ActorTransform.GetRotation(), ActorTransform.GetLocation());
+
+	float BestDistance = MaxDistance;
+	int32 BestHitbox = INDEX_NONE;
+	FVector BestNormal = FVector::ZeroVector;
+
+	for (int32 i = 0; i < Hitboxes.Num(); i++)
+	{
+		const FSHitbox& Hitbox = Hitboxes[i];
+
+		FTransform HitboxToActor(Hitbox.Rotation, Hitbox.Offset);
+		if (Mesh && Hitbox.BoneName != NAME_None)
+		{
+			FTransform BoneToActor = Mesh->GetSocketTransform(Hitbox.BoneName, RTS_Actor);
+			BoneToActor.RemoveScaling();
+			HitboxToActor = HitboxToActor * BoneToActor;
+		}
+
+		float Distance;
+		FVector Normal;
+		if (Hitbox.Raycast(HitboxToActor * RigidActorTransform, Start, Direction, BestDistance, Distance, Normal) && Distance < BestDistance)
+		{
+			BestDistance = Distance;
+			BestHitbox = i;
+			BestNormal = Normal;
+		}
+	}
+
+	if (BestHitbox == INDEX_NONE)
+	{
+		return false;
+	}
+
+	const FVector HitLocation = Start + Direction * BestDistance;
+
+	OutHit = FHitResult(Actor, Mesh ? const_cast<USkeletalMeshComponent*>(Mesh) : nullptr, HitLocation, BestNormal);
+	OutHit.bBlockingHit = true;
+	OutHit.Time = MaxDistance > 0.0f ? BestDistance / MaxDistance : 0.0f;
+	OutHit.Distance = BestDistance;
+	OutHit.TraceStart = Start;
+	OutHit.TraceEnd = End;
+	OutHit.Item = BestHitbox;
+	OutHit.BoneName = Hitboxes[BestHitbox].BoneName;
+	return true;
+}
@@ -5,6 +5,7 @@
 #include "Components/DecalComponent.h"
 #include "SPowerupActor.h"
 #include "TimerManager.h"
+#include "Net/UnrealNetwork.h"
 
 
 // Sets default values
@@ -21,7 +22,12 @@ ASPickupActor::ASPickupActor()
 
 	CooldownDuration = 10.0f;
 
+	bPowerupAvailable = false;
+	bRespawnWhenExpired = false;
+
 	SetReplicates(true);
+	// Idle for most of the match, only flushed when the powerup is taken or comes back
+	NetDormancy = DORM_DormantAll;
 }
 
 // Called when the game starts or when spawned
@@ -36,7 +42,7 @@ void ASPickupActor::BeginPlay()
 }
 
 
-void ASPickupActor::Respawn()
+void ASPickupActor::SpawnPowerupInstance()
 {
 	if (PowerUpClass == nullptr)
 	{
@@ -45,22 +51,84 @@ void ASPickupActor::Respawn()
 	}
 
 	FActorSpawnParameters SpawnParams;
+	SpawnParams.Owner = this;
 	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
 
 	PowerUpInstance = GetWorld()->SpawnActor<ASPowerupActor>(PowerUpClass, GetTransform(), SpawnParams);
 }
 
 
+void ASPickupActor::Respawn()
+{
+	if (PowerUpInstance == nullptr || PowerUpInstance->IsPendingKill())
+	{
+		// First respawn, or the Blueprint destroyed the previous instance
+		FlushNetDormancy();
+		SpawnPowerupInstance();
+
+		if (PowerUpInstance == nullptr)
+		{
+			return;
+		}
+	}
+	else if (PowerUpInstance->IsPowerupActive())
+	{
+		// Still running on whoever picked it up, reuse it once it expires
+		bRespawnWhenExpired = true;
+		return;
+	}
+
+	bRespawnWhenExpired = false;
+
+	PowerUpInstance->ResetPowerup();
+
+	FlushNetDormancy();
+	bPowerupAvailable = true;
+	OnRep_PowerupAvailable();
+}
+
+
+void ASPickupActor::OnPowerupExpired(ASPowerupActor* Powerup)
+{
+	if (Role == ROLE_Authority && Powerup == PowerUpInstance && bRespawnWhenExpired)
+	{
+		Respawn();
+	}
+}
+
+
+void ASPickupActor::OnRep_PowerupAvailable()
+{
+	if (PowerUpInstance)
+	{
+		PowerUpInstance->SetPowerupVisible(bPowerupAvailable);
+	}
+}
+
+
 void ASPickupActor::NotifyActorBeginOverlap(AActor* OtherActor)
 {
 	Super::NotifyActorBeginOverlap(OtherActor);
 
-	if (Role == ROLE_Authority && PowerUpInstance)
+	if (Role == ROLE_Authority && bPowerupAvailable && PowerUpInstance)
 	{
+		FlushNetDormancy();
+		bPowerupAvailable = false;
+		OnRep_PowerupAvailable();
+
 		PowerUpInstance->ActivatePowerup(OtherActor);
-		PowerUpInstance = nullptr;
 
 		// Set Timer to respawn powerup
 		GetWorldTimerManager().SetTimer(TimerHandle_RespawnTimer, this, &ASPickupActor::Respawn, CooldownDuration);
 	}
 }
+
+
+void ASPickupActor::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// Only changes if the pooled instance had to be replaced
+	DOREPLIFETIME(ASPickupActor, PowerUpInstance);
+	DOREPLIFETIME(ASPickupActor, bPowerupAvailable);
+}
@@ -1,11 +1,142 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "SPlayerState.h"
+#include "CoopGame.h"
+#include "Engine/World.h"
+#include "Net/UnrealNetwork.h"
+#include "SWeapon.h"
 
+static float ShotBudgetTolerance = 1.25f;
+FAutoConsoleVariableRef CVARShotBudgetTolerance(
+	TEXT("COOP.ShotBudgetTolerance"),
+	ShotBudgetTolerance,
+	TEXT("How much faster than its rate of fire a client may fire before its shots are dropped"),
+	ECVF_Default);
 
+static float ShotBudgetBurst = 1.0f;
+FAutoConsoleVariableRef CVARShotBudgetBurst(
+	TEXT("COOP.ShotBudgetBurst"),
+	ShotBudgetBurst,
+	TEXT("Seconds of fire a client may deliver at once, covers resent and bunched up shot batches"),
+	ECVF_Default);
+
+static float ShotFloodFlagStrikes = 30.0f;
+FAutoConsoleVariableRef CVARShotFloodFlagStrikes(
+	TEXT("COOP.ShotFloodFlagStrikes"),
+	ShotFloodFlagStrikes,
+	TEXT("Dropped shots after which a client is flagged and all of its shots are dropped until the strikes decay"),
+	ECVF_Default);
+
+// Strikes forgiven per second
+static const float ShotFloodStrikeDecay = 2.0f;
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shots Over Budget"), STAT_ShotsOverBudget, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shot Flood Flags"), STAT_ShotFloodFlags, STATGROUP_CoopGame);
+
+
+ASPlayerState::ASPlayerState()
+{
+	// Filled up on the first shot
+	ShotTokens = -1.0f;
+	LastShotTokenTime = 0.0f;
+	ShotFloodStrikes = 0.0f;
+	bShotFloodFlagged = false;
+
+	CurrentWeaponIndex = 0;
+}
 
 
 void ASPlayerState::AddScore(float ScoreDelta)
 {
 	Score += ScoreDelta;
 }
+
+
+bool ASPlayerState::ConsumeShotToken(float ShotsPerSecond)
+{
+	const float Now = GetWorld()->TimeSeconds;
+	const float Rate = ShotsPerSecond * ShotBudgetTolerance;
+	const float MaxTokens = FMath::Max(Rate * ShotBudgetBurst, 1.0f);
+
+	const float DeltaTime = Now - LastShotTokenTime;
+	LastShotTokenTime = Now;
+
+	ShotTokens = ShotTokens < 0.0f ? MaxTokens : FMath::Min(ShotTokens + DeltaTime * Rate, MaxTokens);
+	ShotFloodStrikes = FMath::Max(ShotFloodStrikes - DeltaTime * ShotFloodStrikeDecay, 0.0f);
+
+	if (bShotFloodFlagged && ShotFloodStrikes <= 0.0f)
+	{
+		UE_LOG(LogTemp, Log, TEXT("%s is no longer flagged for shot flooding"), *GetPlayerName());
+		bShotFloodFlagged = false;
+	}
+
+	if (!bShotFloodFlagged && ShotTokens >= 1.0f)
+	{
+		ShotTokens -= 1.0f;
+		return true;
+	}
+
+	INC_DWORD_STAT(STAT_ShotsOverBudget);
+
+	// Flagged players keep their strikes topped up, they have to stop firing to get unflagged
+	ShotFloodStrikes = FMath::Min(ShotFloodStrikes + 1.0f, ShotFloodFlagStrikes);
+	if (!bShotFloodFlagged && ShotFloodStrikes >= ShotFloodFlagStrikes)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s flagged for shot flooding, dropping all of their shots"), *GetPlayerName());
+		INC_DWORD_STAT(STAT_ShotFloodFlags);
+		bShotFloodFlagged = true;
+	}
+
+	return false;
+}
+
+
+void ASPlayerState::AddWeapon(ASWeapon* Weapon)
+{
+	if (Weapon)
+	{
+		Weapons.Add(Weapon);
+	}
+}
+
+
+ASWeapon* ASPlayerState::GetWeapon(int32 Index) const
+{
+	return Weapons.IsValidIndex(Index) ? Weapons[Index] : nullptr;
+}
+
+
+void ASPlayerState::SetCurrentWeaponIndex(int32 Index)
+{
+	if (Weapons.IsValidIndex(Index))
+	{
+		CurrentWeaponIndex = Index;
+	}
+}
+
+
+void ASPlayerState::Destroyed()
+{
+	if (Role == ROLE_Authority)
+	{
+		for (ASWeapon* Weapon : Weapons)
+		{
+			if (Weapon)
+			{
+				Weapon->Destroy();
+			}
+		}
+
+		Weapons.Reset();
+	}
+
+	Super::Destroyed();
+}
+
+
+void ASPlayerState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(ASPlayerState, Weapons, COND_OwnerOnly);
+}
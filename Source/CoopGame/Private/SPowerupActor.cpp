@@ -1,6 +1,9 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "SPowerupActor.h"
+#include "SHealthComponent.h"
+#include "SCharacter.h"
+#include "SPickupActor.h"
 #include "Net/UnrealNetwork.h"
 
 
@@ -10,9 +13,14 @@ ASPowerupActor::ASPowerupActor()
 	PowerupInterval = 0.0f;
 	TotalNrOfTicks = 0;
 
+	EffectType = EPowerupEffect::Custom;
+	EffectMagnitude = 0.0f;
+
 	bIsPowerupActive = false;
 
 	SetReplicates(true);
+	// Only replicates when activated, expired or reset
+	NetDormancy = DORM_DormantAll;
 }
 
 
@@ -20,23 +28,63 @@ void ASPowerupActor::OnTickPowerup()
 {
 	TicksProcessed++;
 
-	OnPowerupTicked();
+	if (EffectType == EPowerupEffect::HealOverTime)
+	{
+		USHealthComponent* HealthComp = USHealthComponent::FindHealthComponent(ActiveForActor);
+		if (HealthComp)
+		{
+			HealthComp->Heal(EffectMagnitude);
+		}
+	}
+	else if (EffectType == EPowerupEffect::Custom)
+	{
+		OnPowerupTicked();
+	}
 
 	if (TicksProcessed >= TotalNrOfTicks)
 	{
 		OnExpired();
 
+		FlushNetDormancy();
 		bIsPowerupActive = false;
 		OnRep_PowerupActive();
 
-		// Delete timer
-		GetWorldTimerManager().ClearTimer(TimerHandle_PowerupTick);
+		// Stop ticking
+		ASEffectScheduler* Scheduler = ASWorldManager::Get<ASEffectScheduler>(this, false);
+		if (Scheduler)
+		{
+			Scheduler->StopEffect(PowerupTickEffect);
+		}
+
+		// Let the pickup know this instance can be reused
+		ASPickupActor* Pickup = Cast<ASPickupActor>(GetOwner());
+		if (Pickup)
+		{
+			Pickup->OnPowerupExpired(this);
+		}
 	}
 }
 
 
 void ASPowerupActor::OnRep_PowerupActive()
 {
+	if (EffectType == EPowerupEffect::SpeedBoost)
+	{
+		// Applied on server and clients so character movement prediction agrees. Removed from the character it was
+		// applied to, ActiveForActor may already be cleared by the time a client hears the powerup expired.
+		ASCharacter* Character = Cast<ASCharacter>(ActiveForActor);
+		if (bIsPowerupActive && Character)
+		{
+			Character->AddSpeedBoost(this, EffectMagnitude);
+			BoostedCharacter = Character;
+		}
+		else if (!bIsPowerupActive && BoostedCharacter.IsValid())
+		{
+			BoostedCharacter->RemoveSpeedBoost(this);
+			BoostedCharacter.Reset();
+		}
+	}
+
 	OnPowerupStateChanged(bIsPowerupActive);
 }
 
@@ -45,12 +93,17 @@ void ASPowerupActor::ActivatePowerup(AActor* ActiveFor)
 {
 	OnActivated(ActiveFor);
 
+	FlushNetDormancy();
+	ActiveForActor = ActiveFor;
+	TicksProcessed = 0;
+
 	bIsPowerupActive = true;
 	OnRep_PowerupActive();
 
-	if (PowerupInterval > 0.0f)
+	ASEffectScheduler* Scheduler = ASWorldManager::Get<ASEffectScheduler>(this);
+	if (PowerupInterval > 0.0f && Scheduler)
 	{
-		GetWorldTimerManager().SetTimer(TimerHandle_PowerupTick, this, &ASPowerupActor::OnTickPowerup, PowerupInterval, true);
+		PowerupTickEffect = Scheduler->StartEffect(FSEffectTickDelegate::CreateUObject(this, &ASPowerupActor::OnTickPowerup), PowerupInterval);
 	}
 	else
 	{
@@ -58,9 +111,47 @@ void ASPowerupActor::ActivatePowerup(AActor* ActiveFor)
 	}
 }
 
+void ASPowerupActor::ResetPowerup()
+{
+	ASEffectScheduler* Scheduler = ASWorldManager::Get<ASEffectScheduler>(this, false);
+	if (Scheduler)
+	{
+		Scheduler->StopEffect(PowerupTickEffect);
+	}
+
+	if (bIsPowerupActive)
+	{
+		FlushNetDormancy();
+		bIsPowerupActive = false;
+		OnRep_PowerupActive();
+	}
+
+	if (ActiveForActor)
+	{
+		FlushNetDormancy();
+		ActiveForActor = nullptr;
+	}
+
+	TicksProcessed = 0;
+}
+
+
+void ASPowerupActor::SetPowerupVisible(bool bVisible)
+{
+	if (RootComponent)
+	{
+		// Propagate so meshes hidden by the Blueprint on activation are shown again
+		RootComponent->SetVisibility(bVisible, true);
+	}
+
+	SetActorEnableCollision(bVisible);
+}
+
+
 void ASPowerupActor::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
 	DOREPLIFETIME(ASPowerupActor, bIsPowerupActive);
+	DOREPLIFETIME(ASPowerupActor, ActiveForActor);
 }
\ No newline at end of file
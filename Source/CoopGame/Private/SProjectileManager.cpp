@@ -0,0 +1,276 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SProjectileManager.h"
+#include "CoopGame.h"
+#include "SProjectileWeapon.h"
+#include "SLagCompensation.h"
+#include "SFXPool.h"
+#include "Engine/World.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile Update"), STAT_ProjectileUpdate, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles In Flight"), STAT_ProjectilesInFlight, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Impacts"), STAT_ProjectileImpacts, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles Dropped"), STAT_ProjectilesDropped, STATGROUP_CoopGame);
+
+
+ASProjectileManager::ASProjectileManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+}
+
+
+int32 ASProjectileManager::GetTypeIndex(const ASProjectileWeapon* Weapon)
+{
+	ASProjectileWeapon* Type = Weapon->GetClass()->GetDefaultObject<ASProjectileWeapon>();
+
+	int32 TypeIndex = Types.Find(Type);
+	if (TypeIndex == INDEX_NONE && Types.Num() <= MAX_uint8)
+	{
+		TypeIndex = Types.Add(Type);
+	}
+
+	return TypeIndex;
+}
+
+
+void ASProjectileManager::SpawnProjectile(ASProjectileWeapon* Weapon, uint16 ShotIndex, const FVector& Location, const FVector& Direction, bool bAuthoritative)
+{
+	const int32 TypeIndex = GetTypeIndex(Weapon);
+	if (Ages.Num() >= MaxProjectiles || TypeIndex == INDEX_NONE)
+	{
+		INC_DWORD_STAT(STAT_ProjectilesDropped);
+		return;
+	}
+
+	const FSProjectileParams& Params = Types[TypeIndex]->GetProjectileParams();
+	const FVector Velocity = Direction * Params.InitialSpeed;
+
+	PositionsX.Add(Location.X);
+	PositionsY.Add(Location.Y);
+	PositionsZ.Add(Location.Z);
+
+	VelocitiesX.Add(Velocity.X);
+	VelocitiesY.Add(Velocity.Y);
+	VelocitiesZ.Add(Velocity.Z);
+
+	NextX.Add(Location.X);
+	NextY.Add(Location.Y);
+	NextZ.Add(Location.Z);
+
+	GravitiesZ.Add(GetWorld()->GetGravityZ() * Params.GravityScale);
+	Drags.Add(Params.Drag);
+	Ages.Add(0.0f);
+	Lifetimes.Add(Params.Lifetime);
+	ShotIndices.Add(ShotIndex);
+	TypeIndices.Add((uint8)TypeIndex);
+	Authoritative.Add(bAuthoritative);
+
+	AActor* WeaponOwner = Weapon->GetOwner();
+	Weapons.Add(Weapon);
+	Instigators.Add(WeaponOwner);
+	InstigatorControllers.Add(WeaponOwner ? WeaponOwner->GetInstigatorController() : nullptr);
+
+	UParticleSystemComponent* Visual = nullptr;
+	if (Params.ProjectileEffect && GetNetMode() != NM_DedicatedServer)
+	{
+		Visual = ASFXPool::SpawnEmitterAtLocation(this, Params.ProjectileEffect, Location, Direction.Rotation());
+	}
+	Visuals.Add(Visual);
+
+	if (!IsActorTickEnabled())
+	{
+		SetActorTickEnabled(true);
+	}
+}
+
+
+void ASProjectileManager::RemoveProjectile(const ASProjectileWeapon* Weapon, uint16 ShotIndex)
+{
+	for (int32 i = 0; i < ShotIndices.Num(); i++)
+	{
+		if (ShotIndices[i] == ShotIndex && Weapons[i].Get() == Weapon && !Authoritative[i])
+		{
+			RemoveAt(i);
+			return;
+		}
+	}
+}
+
+
+void ASProjectileManager::RemoveAt(int32 Index)
+{
+	if (UParticleSystemComponent* Visual = Visuals[Index].Get())
+	{
+		// Lets the trail fade out, the pool takes the component back once it finished
+		Visual->DeactivateSystem();
+	}
+
+	PositionsX.RemoveAtSwap(Index, 1, false);
+	PositionsY.RemoveAtSwap(Index, 1, false);
+	PositionsZ.RemoveAtSwap(Index, 1, false);
+	VelocitiesX.RemoveAtSwap(Index, 1, false);
+	VelocitiesY.RemoveAtSwap(Index, 1, false);
+	VelocitiesZ.RemoveAtSwap(Index, 1, false);
+	NextX.RemoveAtSwap(Index, 1, false);
+	NextY.RemoveAtSwap(Index, 1, false);
+	NextZ.RemoveAtSwap(Index, 1, false);
+	GravitiesZ.RemoveAtSwap(Index, 1, false);
+	Drags.RemoveAtSwap(Index, 1, false);
+	Ages.RemoveAtSwap(Index, 1, false);
+	Lifetimes.RemoveAtSwap(Index, 1, false);
+	ShotIndices.RemoveAtSwap(Index, 1, false);
+	TypeIndices.RemoveAtSwap(Index, 1, false);
+	Authoritative.RemoveAtSwap(Index, 1, false);
+	Weapons.RemoveAtSwap(Index, 1, false);
+	Instigators.RemoveAtSwap(Index, 1, false);
+	InstigatorControllers.RemoveAtSwap(Index, 1, false);
+	Visuals.RemoveAtSwap(Index, 1, false);
+}
+
+
+void ASProjectileManager::Integrate(float DeltaSeconds)
+{
+	const int32 NumProjectiles = Ages.Num();
+
+	const float* RESTRICT PX = PositionsX.GetData();
+	const float* RESTRICT PY = PositionsY.GetData();
+	const float* RESTRICT PZ = PositionsZ.GetData();
+	float* RESTRICT VX = VelocitiesX.GetData();
+	float* RESTRICT VY = VelocitiesY.GetData();
+	float* RESTRICT VZ = VelocitiesZ.GetData();
+	float* RESTRICT NX = NextX.GetData();
+	float* RESTRICT NY = NextY.GetData();
+	float* RESTRICT NZ = NextZ.GetData();
+	const float* RESTRICT GZ = GravitiesZ.GetData();
+	const float* RESTRICT Drag = Drags.GetData();
+	float* RESTRICT Age = Ages.GetData();
+
+	// Straight line arithmetic over separate float arrays, the compiler turns this into SIMD
+	for (int32 i = 0; i < NumProjectiles; i++)
+	{
+		const float Damping = FMath::Max(1.0f - Drag[i] * DeltaSeconds, 0.0f);
+
+		VX[i] = VX[i] * Damping;
+		VY[i] = VY[i] * Damping;
+		VZ[i] = VZ[i] * Damping + GZ[i] * DeltaSeconds;
+
+		NX[i] = PX[i] + VX[i] * DeltaSeconds;
+		NY[i] = PY[i] + VY[i] * DeltaSeconds;
+		NZ[i] = PZ[i] + VZ[i] * DeltaSeconds;
+
+		Age[i] += DeltaSeconds;
+	}
+}
+
+
+bool ASProjectileManager::Sweep(int32 Index, ASLagCompensation* LagCompensation, FHitResult& OutHit, bool& bOutExpired) const
+{
+	const FVector Start(PositionsX[Index], PositionsY[Index], PositionsZ[Index]);
+	const FVector End(NextX[Index], NextY[Index], NextZ[Index]);
+
+	bOutExpired = Ages[Index] >= Lifetimes[Index];
+
+	FCollisionQueryParams QueryParams;
+	QueryParams.AddIgnoredActor(Instigators[Index].Get());
+	QueryParams.AddIgnoredActor(Weapons[Index].Get());
+	QueryParams.bReturnPhysicalMaterial = true;
+
+	// The server's projectiles hit pawns through their hitboxes, like hitscan shots
+	const bool bHit = LagCompensation && Authoritative[Index] ? LagCompensation->LineTraceShot(OutHit, Start, End, COLLISION_WEAPON, QueryParams)
+		: GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, COLLISION_WEAPON, QueryParams);
+
+	if (!bHit && bOutExpired)
+	{
+		OutHit = FHitResult(nullptr, nullptr, End, -(End - Start).GetSafeNormal());
+	}
+
+	return bHit || bOutExpired;
+}
+
+
+void ASProjectileManager::Impact(int32 Index, const FHitResult& Hit)
+{
+	INC_DWORD_STAT(STAT_ProjectileImpacts);
+
+	const ASProjectileWeapon* Type = Types[TypeIndices[Index]];
+	const FVector Direction = FVector(VelocitiesX[Index], VelocitiesY[Index], VelocitiesZ[Index]).GetSafeNormal();
+
+	Type->ApplyProjectileDamage(this, Hit, Direction, Instigators[Index].Get(), InstigatorControllers[Index].Get());
+
+	EPhysicalSurface SurfaceType = SurfaceType_Default;
+	if (Hit.bBlockingHit)
+	{
+		ASLagCompensation* LagCompensation = ASWorldManager::Get<ASLagCompensation>(this, false);
+		const FSHitbox* Hitbox = LagCompensation ? LagCompensation->GetHitbox(Hit) : nullptr;
+		SurfaceType = Hitbox ? Hitbox->SurfaceType.GetValue() : UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get());
+	}
+
+	if (ASProjectileWeapon* Weapon = Weapons[Index].Get())
+	{
+		Weapon->OnProjectileImpact(ShotIndices[Index], Hit.ImpactPoint, SurfaceType);
+	}
+}
+
+
+void ASProjectileManager::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	SCOPE_CYCLE_COUNTER(STAT_ProjectileUpdate);
+
+	Integrate(DeltaSeconds);
+
+	ASLagCompensation* LagCompensation = ASWorldManager::Get<ASLagCompensation>(this, false);
+
+	// Backwards, so a removal only swaps in a projectile that was already handled
+	for (int32 i = Ages.Num() - 1; i >= 0; i--)
+	{
+		FHitResult Hit;
+		bool bExpired;
+		if (Sweep(i, LagCompensation, Hit, bExpired))
+		{
+			// Projectiles without an explosion just vanish at the end of their lifetime, clients expire their copies themselves
+			const bool bExplodes = Types[TypeIndices[i]]->GetProjectileParams().ExplosionRadius > 0.0f;
+			if (Authoritative[i] && (Hit.bBlockingHit || bExplodes))
+			{
+				Impact(i, Hit);
+			}
+
+			RemoveAt(i);
+			continue;
+		}
+
+		PositionsX[i] = NextX[i];
+		PositionsY[i] = NextY[i];
+		PositionsZ[i] = NextZ[i];
+
+		if (UParticleSystemComponent* Visual = Visuals[i].Get())
+		{
+			Visual->SetWorldLocation(FVector(NextX[i], NextY[i], NextZ[i]));
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_ProjectilesInFlight, Ages.Num());
+
+	if (Ages.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+
+void ASProjectileManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for (const TWeakObjectPtr<UParticleSystemComponent>& Visual : Visuals)
+	{
+		if (Visual.IsValid())
+		{
+			Visual->DeactivateSystem();
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
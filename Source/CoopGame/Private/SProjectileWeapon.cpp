@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SProjectileWeapon.h"
+#include "CoopGame.h"
+#include "SProjectileManager.h"
+#include "SLagCompensation.h"
+#include "Kismet/GameplayStatics.h"
+#include "Net/UnrealNetwork.h"
+
+
+ASProjectileWeapon::ASProjectileWeapon()
+{
+	RateOfFire = 90;
+	BaseDamage = 60.0f;
+
+	ProjectileImpacts.ImpactCounter = 0;
+	LastPlayedImpactCounter = 0;
+}
+
+
+void ASProjectileWeapon::ProcessShot(const FVector& EyeLocation, FHitScanTrace& Shot, float RewindTime)
+{
+	//Projectiles fly from where the shooter is now, there is nothing to rewind
+	LaunchProjectile(EyeLocation, Shot);
+
+	//Remote clients launch their own copy from the replicated shot
+	if (Role == ROLE_Authority)
+	{
+		Shot.HitDistance = MAX_uint16;
+		AddHitScanTrace(Shot);
+	}
+}
+
+
+void ASProjectileWeapon::PlayHitScanTrace(const FVector& EyeLocation, const FHitScanTrace& Shot)
+{
+	LaunchProjectile(EyeLocation, Shot);
+}
+
+
+void ASProjectileWeapon::LaunchProjectile(const FVector& EyeLocation, const FHitScanTrace& Shot)
+{
+	const FRotator AimRotation(FRotator::DecompressAxisFromShort(Shot.AimPitch), FRotator::DecompressAxisFromShort(Shot.AimYaw), 0.0f);
+	FVector ShotDirection = GetShotDirection(AimRotation, Shot.ShotIndex, Shot.GetSpreadFlags());
+
+	ASProjectileManager* ProjectileManager = ASWorldManager::Get<ASProjectileManager>(this);
+	if (ProjectileManager)
+	{
+		ProjectileManager->SpawnProjectile(this, Shot.ShotIndex, EyeLocation, ShotDirection, Role == ROLE_Authority);
+	}
+
+	PlayFireEffects(EyeLocation + ShotDirection * ProjectileParams.InitialSpeed);
+}
+
+
+void ASProjectileWeapon::ApplyProjectileDamage(const UObject* WorldContextObject, const FHitResult& Hit, const FVector& Direction, AActor* DamageCauser, AController* InstigatorController) const
+{
+	if (ProjectileParams.ExplosionRadius > 0.0f)
+	{
+		TArray<AActor*> IgnoredActors;
+		UGameplayStatics::ApplyRadialDamage(WorldContextObject, BaseDamage, Hit.ImpactPoint, ProjectileParams.ExplosionRadius, DamageType, IgnoredActors, DamageCauser, InstigatorController, false);
+		return;
+	}
+
+	AActor* HitActor = Hit.GetActor();
+	if (HitActor == nullptr)
+	{
+		return;
+	}
+
+	//Hitboxes scale the damage the same way as for hitscan shots
+	float ActualDamage = BaseDamage;
+	ASLagCompensation* LagCompensation = ASWorldManager::Get<ASLagCompensation>(WorldContextObject, false);
+	const FSHitbox* Hitbox = LagCompensation ? LagCompensation->GetHitbox(Hit) : nullptr;
+	if (Hitbox)
+	{
+		ActualDamage *= Hitbox->DamageMultiplier;
+	}
+
+	UGameplayStatics::ApplyPointDamage(HitActor, ActualDamage, Direction, Hit, InstigatorController, DamageCauser, DamageType);
+}
+
+
+void ASProjectileWeapon::OnProjectileImpact(uint16 ShotIndex, const FVector& Location, EPhysicalSurface SurfaceType)
+{
+	FSProjectileImpact& Impact = ProjectileImpacts.Impacts[ProjectileImpacts.ImpactCounter % ARRAY_COUNT(ProjectileImpacts.Impacts)];
+	Impact.ShotIndex = ShotIndex;
+	Impact.SurfaceType = SurfaceType;
+	Impact.Location = Location;
+	ProjectileImpacts.ImpactCounter++;
+
+	PlayImpactEffects(SurfaceType, Location);
+}
+
+
+void ASProjectileWeapon::OnRep_ProjectileImpacts()
+{
+	const uint8 NumNewImpacts = ProjectileImpacts.ImpactCounter - LastPlayedImpactCounter;
+	LastPlayedImpactCounter = ProjectileImpacts.ImpactCounter;
+
+	if (!HasActorBegunPlay())
+	{
+		return;
+	}
+
+	ASProjectileManager* ProjectileManager = ASWorldManager::Get<ASProjectileManager>(this, false);
+
+	// Oldest first, the server's impact replaces wherever the local copy of the projectile is
+	const int32 NumImpactsToPlay = FMath::Min<int32>(NumNewImpacts, ARRAY_COUNT(ProjectileImpacts.Impacts));
+	for (int32 i = NumImpactsToPlay; i > 0; i--)
+	{
+		const FSProjectileImpact& Impact = ProjectileImpacts.Impacts[(uint8)(ProjectileImpacts.ImpactCounter - i) % ARRAY_COUNT(ProjectileImpacts.Impacts)];
+
+		if (ProjectileManager)
+		{
+			ProjectileManager->RemoveProjectile(this, Impact.ShotIndex);
+		}
+
+		PlayImpactEffects((EPhysicalSurface)Impact.SurfaceType, Impact.Location);
+	}
+}
+
+
+void ASProjectileWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ASProjectileWeapon, ProjectileImpacts);
+}
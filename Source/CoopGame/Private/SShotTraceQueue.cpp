@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SShotTraceQueue.h"
+#include "CoopGame.h"
+#include "SLagCompensation.h"
+#include "Engine/World.h"
+
+static int32 AsyncShotTraces = 0;
+FAutoConsoleVariableRef CVARAsyncShotTraces(
+	TEXT("COOP.AsyncShotTraces"),
+	AsyncShotTraces,
+	TEXT("Trace server shots asynchronously and apply them in one batch at the start of the next frame"),
+	ECVF_Default);
+
+DECLARE_CYCLE_STAT(TEXT("Shot Trace Queue Resolve"), STAT_ShotTraceQueueResolve, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Async Shot Traces"), STAT_AsyncShotTraces, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Async Shot Traces Retraced"), STAT_AsyncShotTracesRetraced, STATGROUP_CoopGame);
+
+
+ASShotTraceQueue::ASShotTraceQueue()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	// First thing in the frame, the async traces of the last frame finished when the world started ticking
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+}
+
+
+bool ASShotTraceQueue::IsEnabled()
+{
+	return AsyncShotTraces > 0;
+}
+
+
+void ASShotTraceQueue::QueueShot(ASWeapon* Weapon, const FVector& Start, const FVector& Direction, float Range, const FCollisionQueryParams& Params, float RewindTime, const FHitScanTrace& Shot)
+{
+	INC_DWORD_STAT(STAT_AsyncShotTraces);
+
+	const FVector End = Start + Direction * Range;
+
+	FQueuedShot& Queued = QueuedShots[QueuedShots.AddDefaulted()];
+	Queued.Weapon = Weapon;
+	Queued.Shot = Shot;
+	Queued.Start = Start;
+	Queued.End = End;
+	Queued.Direction = Direction;
+	Queued.Params = Params;
+	Queued.Frame = GFrameCounter;
+	Queued.bPawnHit = false;
+
+	// The world trace leaves the pawns to the lag compensation, which tests them now while their history is at hand
+	FCollisionQueryParams WorldParams = Params;
+	ASLagCompensation* LagCompensation = ASWorldManager::Get<ASLagCompensation>(this, false);
+	if (LagCompensation)
+	{
+		LagCompensation->AddIgnoredPawns(WorldParams);
+		Queued.bPawnHit = LagCompensation->LineTracePawns(Queued.PawnHit, Start, End, COLLISION_WEAPON, Params, RewindTime);
+	}
+
+	Queued.WorldTrace = GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, Start, End, COLLISION_WEAPON, WorldParams);
+
+	if (!IsActorTickEnabled())
+	{
+		SetActorTickEnabled(true);
+	}
+}
+
+
+void ASShotTraceQueue::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	ResolveShots();
+
+	if (QueuedShots.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+
+void ASShotTraceQueue::ResolveShots()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShotTraceQueueResolve);
+
+	UWorld* World = GetWorld();
+
+	int32 NumResolved = 0;
+	while (NumResolved < QueuedShots.Num() && QueuedShots[NumResolved].Frame < GFrameCounter)
+	{
+		FQueuedShot& Queued = QueuedShots[NumResolved++];
+
+		ASWeapon* Weapon = Queued.Weapon.Get();
+		if (Weapon == nullptr)
+		{
+			continue;
+		}
+
+		FHitResult Hit;
+		bool bHit = false;
+
+		FTraceDatum TraceData;
+		if (World->QueryTraceData(Queued.WorldTrace, TraceData))
+		{
+			for (const FHitResult& WorldHit : TraceData.OutHits)
+			{
+				if (WorldHit.bBlockingHit)
+				{
+					Hit = WorldHit;
+					bHit = true;
+					break;
+				}
+			}
+		}
+		else
+		{
+			// Async results only live for one frame, after a hitch trace the world again
+			INC_DWORD_STAT(STAT_AsyncShotTracesRetraced);
+
+			FCollisionQueryParams WorldParams = Queued.Params;
+			ASLagCompensation* LagCompensation = ASWorldManager::Get<ASLagCompensation>(this, false);
+			if (LagCompensation)
+			{
+				LagCompensation->AddIgnoredPawns(WorldParams);
+			}
+
+			bHit = World->LineTraceSingleByChannel(Hit, Queued.Start, Queued.End, COLLISION_WEAPON, WorldParams);
+		}
+
+		if (Queued.bPawnHit && (!bHit || Queued.PawnHit.Time < Hit.Time))
+		{
+			Hit = Queued.PawnHit;
+			bHit = true;
+		}
+
+		Weapon->ResolveQueuedShot(Queued.Start, Queued.Direction, bHit, Hit, Queued.Shot);
+	}
+
+	QueuedShots.RemoveAt(0, NumResolved, false);
+}
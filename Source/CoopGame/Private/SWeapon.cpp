@@ -8,8 +8,16 @@
 #include "Particles/ParticleSystemComponent.h"
 #include "PhysicalMaterials/PhysicalMaterial.h"
 #include "CoopGame.h"
-#include "TimerManager.h"
 #include "Net/UnrealNetwork.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/Pawn.h"
+#include "SLagCompensation.h"
+#include "SPlayerState.h"
+#include "SFXPool.h"
+#include "SFXBudget.h"
+#include "SShotTraceQueue.h"
+#include "SWeaponFireManager.h"
+#include "SReplayManager.h"
 
 static int32 DebugWeaponDrawing = 0;
 FAutoConsoleVariableRef CVARDebugWeaponDrawing(
@@ -18,6 +26,58 @@ FAutoConsoleVariableRef CVARDebugWeaponDrawing(
 	TEXT("Draw Debug Lines for Weapons"), 
 	ECVF_Cheat);
 
+static float ShotBatchInterval = 0.05f;
+FAutoConsoleVariableRef CVARShotBatchInterval(
+	TEXT("COOP.ShotBatchInterval"),
+	ShotBatchInterval,
+	TEXT("Seconds clients collect shots before sending them to the server in one batch (0 = every frame)"),
+	ECVF_Default);
+
+static float ShotResendInterval = 0.2f;
+FAutoConsoleVariableRef CVARShotResendInterval(
+	TEXT("COOP.ShotResendInterval"),
+	ShotResendInterval,
+	TEXT("Seconds clients wait for the server to acknowledge their shots before sending them again"),
+	ECVF_Default);
+
+// Larger batches are rejected as cheating, a client at 600 RPM fills about 1 shot per 0.1s
+static const int32 MaxShotsPerBatch = 32;
+
+// Hitscan range, also the range hit distances are quantized over
+static const float MaxShotRange = 10000.0f;
+
+static int32 ComplexSurfaceTrace = 1;
+FAutoConsoleVariableRef CVARComplexSurfaceTrace(
+	TEXT("COOP.ComplexSurfaceTrace"),
+	ComplexSurfaceTrace,
+	TEXT("Refine shots that hit the world with a short per-polygon trace for exact impact effects (never on dedicated servers)"),
+	ECVF_Default);
+
+// Length of the complex trace before and after a simple hit
+static const float ComplexSurfaceMargin = 32.0f;
+
+// Shots older than this (in server time) are not traced anymore
+static const float MaxShotAge = 1.0f;
+
+// Most pellets a single shot fires
+static const int32 MaxPellets = 32;
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shot Batches Received"), STAT_ShotBatchesReceived, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shots Received"), STAT_ShotsReceived, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shots Rejected"), STAT_ShotsRejected, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shots Lost"), STAT_ShotsLost, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ammo Corrections"), STAT_AmmoCorrections, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Complex Surface Traces"), STAT_ComplexSurfaceTraces, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pellets Traced"), STAT_PelletsTraced, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pellet Damage Events Merged"), STAT_PelletDamageEventsMerged, STATGROUP_CoopGame);
+
+
+/* Distance from the shooter's eyes to an impact, quantized over the weapon range for FHitScanTrace */
+static uint16 QuantizeHitDistance(float Distance)
+{
+	return (uint16)FMath::Min(FMath::RoundToInt(Distance / MaxShotRange * (MAX_uint16 - 1)), MAX_uint16 - 1);
+}
+
 
 // Sets default values
 ASWeapon::ASWeapon()
@@ -38,6 +98,13 @@ ASWeapon::ASWeapon()
 
 	RateOfFire = 600;
 
+	FireMode = ESFireMode::Automatic;
+	BurstCount = 3;
+	PelletCount = 8;
+	PelletSpread = 6.0f;
+
+	PooledEffectCount = 6;
+
 	SetReplicates(true);
 
 	NetUpdateFrequency = 66.0f;
@@ -46,6 +113,24 @@ ASWeapon::ASWeapon()
 	MaxAmmo = 120;
 	CurrentAmmo = 30;
 	ClipSize = 30;
+
+	ShotCounter = 0;
+	SpreadSeed = 0;
+
+	UnackedFirstShotIndex = 0;
+	NumUnsentShots = 0;
+	LastShotBatchTime = 0.0f;
+	LastAckProgressTime = 0.0f;
+	ServerShotIndex = 0;
+	AckedShotIndex = 0;
+	ReloadCounter = 0;
+	LastPlayedBurstCounter = 0;
+
+	// Only ticks on clients while shots are waiting to be sent or acknowledged
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	// After ASWeaponFireManager fired this frame's shots (TG_PostPhysics), so they go out in the same frame's net update
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
 }
 
 
@@ -55,6 +140,71 @@ void ASWeapon::BeginPlay()
 
 	//Set rate of fire relative to time
 	TimeBetweenShots = 60 / RateOfFire;
+
+	if (Role == ROLE_Authority)
+	{
+		SpreadSeed = ASReplayManager::GetRandomSeed(this);
+	}
+
+	//Have enough effects ready for the first shots of every weapon type
+	if (!IsNetMode(NM_DedicatedServer))
+	{
+		ASFXPool::Prewarm(this, MuzzleEffect, PooledEffectCount);
+		ASFXPool::Prewarm(this, TracerEffect, PooledEffectCount);
+		ASFXPool::Prewarm(this, DefaultImpactEffect, PooledEffectCount);
+		ASFXPool::Prewarm(this, FleshImpactEffect, PooledEffectCount);
+	}
+}
+
+
+void ASWeapon::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	//The server does not trace shots this old anymore, the next batch or ServerStopFire writes them off
+	const float OldestShotTime = GetServerTime() - MaxShotAge;
+
+	int32 NumExpired = 0;
+	while (NumExpired < UnackedShots.Num() - NumUnsentShots && UnackedShots[NumExpired].Timestamp < OldestShotTime)
+	{
+		NumExpired++;
+	}
+
+	if (NumExpired > 0)
+	{
+		UnackedShots.RemoveAt(0, NumExpired, false);
+		UnackedFirstShotIndex += NumExpired;
+	}
+
+	const float Now = GetWorld()->TimeSeconds;
+	const int32 NumSentUnacked = UnackedShots.Num() - NumUnsentShots;
+	if (NumSentUnacked > 0 && Now - LastAckProgressTime >= ShotResendInterval)
+	{
+		//The server has not acknowledged anything for a while, a batch was probably dropped.
+		//It only traces shots in order, so resend from the first unacknowledged one and take new shots along
+		const int32 NumShots = FMath::Min(UnackedShots.Num(), MaxShotsPerBatch);
+		SendShots(0, NumShots);
+		NumUnsentShots = FMath::Min(NumUnsentShots, UnackedShots.Num() - NumShots);
+		LastAckProgressTime = Now;
+	}
+	else if (NumUnsentShots > 0)
+	{
+		if (Now - LastShotBatchTime >= ShotBatchInterval)
+		{
+			FlushPendingShots();
+		}
+	}
+	else if (UnackedShots.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+
+float ASWeapon::GetServerTime() const
+{
+	AGameStateBase* GS = GetWorld()->GetGameState();
+	return GS ? GS->GetServerWorldTimeSeconds() : GetWorld()->TimeSeconds;
 }
 
 // ------- FUNCTION ------- \\
@@ -63,180 +213,726 @@ void ASWeapon::Fire()
 {
 	// Trace the world, from pawn eyes to crosshair location
 
-	if (Role < ROLE_Authority)
+	AActor* MyOwner = GetOwner();
+	if (MyOwner)
 	{
-		//Call server fire if we are not the server
-		ServerFire();
+		//Name variables for location
+		FVector EyeLocation;
+		FRotator EyeRotation;
+		MyOwner->GetActorEyesViewPoint(EyeLocation, EyeRotation);
+
+		FireAt(EyeLocation, EyeRotation, GetWorld()->TimeSeconds);
 	}
+}
+
 
+void ASWeapon::FireAt(const FVector& EyeLocation, const FRotator& EyeRotation, float ShotTime)
+{
 	AActor* MyOwner = GetOwner();
 	if (MyOwner)
 	{
 		//Make sure that we have ammo before we fire
 		if (CurrentAmmo > 0)
 		{
-			//Name variables for location
-			FVector EyeLocation;
-			FRotator EyeRotation;
-			MyOwner->GetActorEyesViewPoint(EyeLocation, EyeRotation);
-
-			FVector ShotDirection = EyeRotation.Vector();
+			//How long ago in this frame the shot was due
+			const float ShotAge = FMath::Max(GetWorld()->TimeSeconds - ShotTime, 0.0f);
 
-			// Bullet Spread
-			float HalfRad;
+			//Shots are traced along the compressed aim everywhere, so the server and remote clients rebuild the exact same shot
+			FHitScanTrace Trace;
+			Trace.AimPitch = FRotator::CompressAxisToShort(EyeRotation.Pitch);
+			Trace.AimYaw = FRotator::CompressAxisToShort(EyeRotation.Yaw);
+			Trace.ShotIndex = (uint16)ShotCounter;
+			Trace.SetSpreadAndSurface(GetSpreadFlags(), SurfaceType_Default);
 
-			//Set the bullet spread acccording to the action that the character is doing
-			if (IsAiming)
+			if (Role < ROLE_Authority)
 			{
-				HalfRad = FMath::DegreesToRadians(AimingBulletSpread);
-			}
-			else if(IsCrouched) {
-				HalfRad = FMath::DegreesToRadians(CrouchedBulletSpread);
+				//Queue the shot for the next batch instead of calling the server for every bullet
+				FSShotRecord Shot;
+				Shot.Timestamp = GetServerTime() - ShotAge;
+				Shot.AimPitch = Trace.AimPitch;
+				Shot.AimYaw = Trace.AimYaw;
+				Shot.SpreadFlags = Trace.GetSpreadFlags();
+
+				//Kept until the server acknowledges it, ShotCounter is the shot's sequence number
+				if (UnackedShots.Num() == 0)
+				{
+					UnackedFirstShotIndex = ShotCounter;
+				}
+
+				UnackedShots.Add(Shot);
+				NumUnsentShots++;
+				SetActorTickEnabled(true);
 			}
-			else if(IsMoving) {
-				HalfRad = FMath::DegreesToRadians(MovingBulletSpread);
+
+			//Shots due earlier in the frame see pawns where they were back then
+			ProcessShot(EyeLocation, Trace, ShotAge > 0.0f ? ShotTime : -1.0f);
+
+			if (Role == ROLE_Authority)
+			{
+				RecordReplayShot(EyeLocation, Trace, ShotAge);
 			}
-			else {
-				HalfRad = FMath::DegreesToRadians(BulletSpread);
+
+			LastFireTime = ShotTime;
+
+			//Reduce ammo by once every time we fire
+			CurrentAmmo--;
+
+			ShotCounter++;
+
+			//A full batch does not wait for the next send
+			if (NumUnsentShots >= MaxShotsPerBatch)
+			{
+				FlushPendingShots();
 			}
-			ShotDirection = FMath::VRandCone(ShotDirection, HalfRad, HalfRad);
+		}
+	}
+}
+
 
-			FVector TraceEnd = EyeLocation + (ShotDirection * 10000);
+void ASWeapon::ProcessShot(const FVector& EyeLocation, FHitScanTrace& Shot, float RewindTime)
+{
+	DispatchFireMode(FireMode, [&](auto Policy)
+	{
+		ProcessShotFor<decltype(Policy)>(EyeLocation, Shot, RewindTime);
+	});
+}
 
-			FCollisionQueryParams QueryParams;
-			QueryParams.AddIgnoredActor(MyOwner);
-			QueryParams.AddIgnoredActor(this);
-			QueryParams.bTraceComplex = true;
-			QueryParams.bReturnPhysicalMaterial = true;
 
-			// Particle "Target" parameter
-			FVector TracerEndPoint = TraceEnd;
+template <typename FireModeType>
+void ASWeapon::ProcessShotFor(const FVector& EyeLocation, FHitScanTrace& Shot, float RewindTime)
+{
+	if (FireModeType::bPellets)
+	{
+		//Pellets are traced together right away, their damage has to be merged before it is applied
+		FirePellets(EyeLocation, Shot, RewindTime, true);
+	}
+	else
+	{
+		//Servers may resolve their shots at the start of the next frame, all in one batch
+		ASShotTraceQueue* TraceQueue = Role == ROLE_Authority && ASShotTraceQueue::IsEnabled() ? ASWorldManager::Get<ASShotTraceQueue>(this) : nullptr;
+		if (TraceQueue)
+		{
+			QueueShot(TraceQueue, EyeLocation, Shot, RewindTime);
+			return;
+		}
 
-			EPhysicalSurface SurfaceType = SurfaceType_Default;
+		FVector TracerEndPoint = FireShot(EyeLocation, Shot, RewindTime);
 
-			FHitResult Hit;
-			//Only run if its a blocking hit
-			if (GetWorld()->LineTraceSingleByChannel(Hit, EyeLocation, TraceEnd, COLLISION_WEAPON, QueryParams))
-			{
-				// Blocking hit! Process damage
-				AActor* HitActor = Hit.GetActor();
+		//Play the effects for firing the weapon
+		PlayFireEffects(TracerEndPoint);
+	}
+
+	//Only run if we are the server
+	if (Role == ROLE_Authority)
+	{
+		AddHitScanTrace(Shot);
+	}
+}
+
+
+FVector ASWeapon::FireShot(const FVector& EyeLocation, FHitScanTrace& Shot, float RewindTime)
+{
+	const FRotator AimRotation(FRotator::DecompressAxisFromShort(Shot.AimPitch), FRotator::DecompressAxisFromShort(Shot.AimYaw), 0.0f);
+	FVector ShotDirection = GetShotDirection(AimRotation, Shot.ShotIndex, Shot.GetSpreadFlags());
+
+	FHitResult Hit;
+	bool bHit = TraceShot(EyeLocation, ShotDirection, Hit, RewindTime);
+
+	return ProcessShotHit(EyeLocation, ShotDirection, bHit, Hit, Shot);
+}
+
+
+void ASWeapon::QueueShot(ASShotTraceQueue* TraceQueue, const FVector& EyeLocation, const FHitScanTrace& Shot, float RewindTime)
+{
+	const FRotator AimRotation(FRotator::DecompressAxisFromShort(Shot.AimPitch), FRotator::DecompressAxisFromShort(Shot.AimYaw), 0.0f);
+	FVector ShotDirection = GetShotDirection(AimRotation, Shot.ShotIndex, Shot.GetSpreadFlags());
+
+	if (DebugWeaponDrawing > 0)
+	{
+		DrawDebugLine(GetWorld(), EyeLocation, EyeLocation + (ShotDirection * MaxShotRange), FColor::White, false, 1.0f, 0, 1.0f);
+	}
+
+	TraceQueue->QueueShot(this, EyeLocation, ShotDirection, MaxShotRange, GetShotQueryParams(), RewindTime, Shot);
+}
+
+
+void ASWeapon::ResolveQueuedShot(const FVector& EyeLocation, const FVector& ShotDirection, bool bHit, FHitResult& Hit, FHitScanTrace& Shot)
+{
+	//The shooter left in the meantime
+	if (GetOwner() == nullptr)
+	{
+		return;
+	}
+
+	if (bHit)
+	{
+		RefineImpactSurface(EyeLocation, ShotDirection, Hit);
+	}
+
+	FVector TracerEndPoint = ProcessShotHit(EyeLocation, ShotDirection, bHit, Hit, Shot);
 
-				//Get the surface type that we hit
-				SurfaceType = UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get());
+	PlayFireEffects(TracerEndPoint);
 
-				//This is the actuall damage that we did
-				float ActualDamage = BaseDamage;
-				//Only run if we hit a flesh vunerable surface type
-				if (SurfaceType == SURFACE_FLESHVULNERABLE)
+	AddHitScanTrace(Shot);
+}
+
+
+FVector ASWeapon::ProcessShotHit(const FVector& EyeLocation, const FVector& ShotDirection, bool bHit, const FHitResult& Hit, FHitScanTrace& Shot)
+{
+	AActor* MyOwner = GetOwner();
+
+	// Particle "Target" parameter
+	FVector TracerEndPoint = EyeLocation + (ShotDirection * MaxShotRange);
+
+	Shot.HitDistance = MAX_uint16;
+
+	//Only run if its a blocking hit
+	if (bHit)
+	{
+		// Blocking hit! Process damage
+		AActor* HitActor = Hit.GetActor();
+
+		//This is the actuall damage that we did
+		EPhysicalSurface SurfaceType;
+		float ActualDamage = GetHitDamage(Hit, SurfaceType);
+
+		//Apply damage to the object that we hit
+		UGameplayStatics::ApplyPointDamage(HitActor, ActualDamage, ShotDirection, Hit, MyOwner->GetInstigatorController(), MyOwner, DamageType);
+
+		//Play effects for mpact
+		PlayImpactEffects(SurfaceType, Hit.ImpactPoint);
+
+		//Set tracer end point to where we hit the actor so the tracer effect doesn't keep on going on
+		TracerEndPoint = Hit.ImpactPoint;
+
+		//Quantize the impact for remote clients, they don't trace at all
+		Shot.HitDistance = QuantizeHitDistance(Hit.Distance);
+		Shot.SetSpreadAndSurface(Shot.GetSpreadFlags(), SurfaceType);
+	}
+
+	return TracerEndPoint;
+}
+
+
+float ASWeapon::GetHitDamage(const FHitResult& Hit, EPhysicalSurface& OutSurfaceType) const
+{
+	float ActualDamage = BaseDamage;
+
+	ASLagCompensation* LagCompensation = ASWorldManager::Get<ASLagCompensation>(this, false);
+	const FSHitbox* Hitbox = LagCompensation ? LagCompensation->GetHitbox(Hit) : nullptr;
+	if (Hitbox)
+	{
+		//Hitboxes carry their own damage region and surface
+		OutSurfaceType = Hitbox->SurfaceType;
+		ActualDamage *= Hitbox->DamageMultiplier;
+	}
+	else
+	{
+		//Get the surface type that we hit
+		OutSurfaceType = UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get());
+
+		//Only run if we hit a flesh vunerable surface type
+		if (OutSurfaceType == SURFACE_FLESHVULNERABLE)
+		{
+			//For headshots multiply the actuall damage by the headshot multiplier
+			ActualDamage *= HeadshotMultiplier;
+		}
+	}
+
+	return ActualDamage;
+}
+
+
+void ASWeapon::FirePellets(const FVector& EyeLocation, FHitScanTrace& Shot, float RewindTime, bool bApplyDamage)
+{
+	TArray<FVector> Ends;
+	TArray<FHitResult> Hits;
+	TracePellets(EyeLocation, Shot, RewindTime, Ends, Hits);
+
+	//Every actor hit by pellets of this shot takes their damage as one event, with the hit of its strongest pellet
+	struct FPelletVictim
+	{
+		AActor* Actor;
+		float Damage;
+		float BestPelletDamage;
+		int32 BestPellet;
+	};
+	TArray<FPelletVictim, TInlineAllocator<8>> Victims;
+	int32 NumPelletHits = 0;
+
+	int32 ClosestPellet = INDEX_NONE;
+	EPhysicalSurface ClosestSurfaceType = SurfaceType_Default;
+
+	for (int32 Pellet = 0; Pellet < Hits.Num(); Pellet++)
+	{
+		const FHitResult& Hit = Hits[Pellet];
+		FVector TracerEndPoint = Ends[Pellet];
+
+		if (Hit.bBlockingHit)
+		{
+			EPhysicalSurface SurfaceType;
+			const float Damage = GetHitDamage(Hit, SurfaceType);
+
+			AActor* HitActor = Hit.GetActor();
+			if (bApplyDamage && HitActor)
+			{
+				FPelletVictim* Victim = Victims.FindByPredicate([HitActor](const FPelletVictim& Other) { return Other.Actor == HitActor; });
+				if (Victim == nullptr)
 				{
-					//For headshots multiply the actuall damage by the headshot multiplier
-					ActualDamage *= HeadshotMultiplier;
+					Victim = &Victims[Victims.AddZeroed()];
+					Victim->Actor = HitActor;
+					Victim->BestPellet = Pellet;
 				}
 
-				//Apply damage to the object that we hit
-				UGameplayStatics::ApplyPointDamage(HitActor, ActualDamage, ShotDirection, Hit, MyOwner->GetInstigatorController(), MyOwner, DamageType);
+				Victim->Damage += Damage;
+				if (Damage > Victim->BestPelletDamage)
+				{
+					Victim->BestPelletDamage = Damage;
+					Victim->BestPellet = Pellet;
+				}
 
-				//Play effects for mpact
-				PlayImpactEffects(SurfaceType, Hit.ImpactPoint);
+				NumPelletHits++;
+			}
 
-				//Set tracer end point to where we hit the actor so the tracer effect doesn't keep on going on
-				TracerEndPoint = Hit.ImpactPoint;
+			PlayImpactEffects(SurfaceType, Hit.ImpactPoint);
 
-			}
+			TracerEndPoint = Hit.ImpactPoint;
 
-			if (DebugWeaponDrawing > 0)
+			if (ClosestPellet == INDEX_NONE || Hit.Distance < Hits[ClosestPellet].Distance)
 			{
-				//If debugging is enabled by the console then draw debug lines for the weapon
-				DrawDebugLine(GetWorld(), EyeLocation, TraceEnd, FColor::White, false, 1.0f, 0, 1.0f);
+				ClosestPellet = Pellet;
+				ClosestSurfaceType = SurfaceType;
 			}
+		}
 
-			//Play the effects for firing the weapon
+		//Muzzle flash and camera shake once per shot
+		if (Pellet == 0)
+		{
 			PlayFireEffects(TracerEndPoint);
+		}
+		else
+		{
+			PlayTracerEffect(TracerEndPoint);
+		}
+	}
 
-			//Only run if we are the server
-			if (Role == ROLE_Authority)
-			{
-				HitScanTrace.TraceTo = TracerEndPoint;
-				HitScanTrace.SurfaceType = SurfaceType;
-			}
+	AActor* MyOwner = GetOwner();
+	for (const FPelletVictim& Victim : Victims)
+	{
+		const FHitResult& Hit = Hits[Victim.BestPellet];
+		const FVector PelletDirection = (Ends[Victim.BestPellet] - EyeLocation).GetSafeNormal();
+		UGameplayStatics::ApplyPointDamage(Victim.Actor, Victim.Damage, PelletDirection, Hit, MyOwner->GetInstigatorController(), MyOwner, DamageType);
+	}
 
-			LastFireTime = GetWorld()->TimeSeconds;
+	INC_DWORD_STAT_BY(STAT_PelletDamageEventsMerged, NumPelletHits - Victims.Num());
 
-			//Reduce ammo by once every time we fire
-			CurrentAmmo--;
+	//Remote clients trace the pellets themselves, the closest impact is only kept for consistency with single shots
+	Shot.HitDistance = MAX_uint16;
+	if (ClosestPellet != INDEX_NONE)
+	{
+		Shot.HitDistance = QuantizeHitDistance(Hits[ClosestPellet].Distance);
+		Shot.SetSpreadAndSurface(Shot.GetSpreadFlags(), ClosestSurfaceType);
+	}
+}
+
+
+void ASWeapon::TracePellets(const FVector& EyeLocation, const FHitScanTrace& Shot, float RewindTime, TArray<FVector>& OutEnds, TArray<FHitResult>& OutHits) const
+{
+	const FRotator AimRotation(FRotator::DecompressAxisFromShort(Shot.AimPitch), FRotator::DecompressAxisFromShort(Shot.AimYaw), 0.0f);
+
+	TArray<FVector> Directions;
+	GetPelletDirections(AimRotation, Shot.ShotIndex, Shot.GetSpreadFlags(), Directions);
+
+	INC_DWORD_STAT_BY(STAT_PelletsTraced, Directions.Num());
+
+	OutEnds.Reset(Directions.Num());
+	for (const FVector& Direction : Directions)
+	{
+		OutEnds.Add(EyeLocation + (Direction * MaxShotRange));
+
+		if (DebugWeaponDrawing > 0)
+		{
+			DrawDebugLine(GetWorld(), EyeLocation, OutEnds.Last(), FColor::White, false, 1.0f, 0, 1.0f);
+		}
+	}
+
+	FCollisionQueryParams QueryParams = GetShotQueryParams();
+
+	//All pellets in one query, every pawn is rewound once for the whole shot
+	ASLagCompensation* LagCompensation = ASWorldManager::Get<ASLagCompensation>(this, false);
+	if (LagCompensation)
+	{
+		LagCompensation->LineTraceShots(OutHits, EyeLocation, OutEnds, COLLISION_WEAPON, QueryParams, RewindTime);
+	}
+	else
+	{
+		OutHits.Reset(OutEnds.Num());
+		OutHits.SetNum(OutEnds.Num());
+		for (int32 Pellet = 0; Pellet < OutEnds.Num(); Pellet++)
+		{
+			OutHits[Pellet].bBlockingHit = GetWorld()->LineTraceSingleByChannel(OutHits[Pellet], EyeLocation, OutEnds[Pellet], COLLISION_WEAPON, QueryParams);
+		}
+	}
+
+	for (int32 Pellet = 0; Pellet < OutHits.Num(); Pellet++)
+	{
+		if (OutHits[Pellet].bBlockingHit)
+		{
+			RefineImpactSurface(EyeLocation, Directions[Pellet], OutHits[Pellet]);
 		}
 	}
 }
 
 
-void ASWeapon::OnRep_HitScanTrace()
+void ASWeapon::GetPelletDirections(const FRotator& AimRotation, uint32 ShotIndex, uint8 SpreadFlags, TArray<FVector>& OutDirections) const
 {
-	// Play cosmetic FX
-	PlayFireEffects(HitScanTrace.TraceTo);
-	PlayImpactEffects(HitScanTrace.SurfaceType, HitScanTrace.TraceTo);
+	// The shot's direction is drawn first from the same stream as single shots, then every pellet around it
+	FRandomStream SpreadStream(HashCombine((uint32)SpreadSeed, (uint16)ShotIndex));
+
+	float HalfRad = GetSpreadHalfAngle(SpreadFlags);
+	const FVector ShotDirection = SpreadStream.VRandCone(AimRotation.Vector(), HalfRad, HalfRad);
+
+	const float PelletHalfRad = FMath::DegreesToRadians(PelletSpread);
+	const int32 NumPellets = FMath::Clamp(PelletCount, 1, MaxPellets);
+
+	OutDirections.Reset(NumPellets);
+	for (int32 Pellet = 0; Pellet < NumPellets; Pellet++)
+	{
+		OutDirections.Add(SpreadStream.VRandCone(ShotDirection, PelletHalfRad, PelletHalfRad));
+	}
 }
 
 
-void ASWeapon::ServerFire_Implementation()
+FVector ASWeapon::GetShotDirection(const FRotator& AimRotation, uint32 ShotIndex, uint8 SpreadFlags) const
 {
-	Fire();
+	// Bullet Spread, every shot gets its own position in the weapon's random stream
+	FRandomStream SpreadStream(HashCombine((uint32)SpreadSeed, (uint16)ShotIndex));
+
+	float HalfRad = GetSpreadHalfAngle(SpreadFlags);
+	return SpreadStream.VRandCone(AimRotation.Vector(), HalfRad, HalfRad);
 }
 
 
-bool ASWeapon::ServerFire_Validate()
+FCollisionQueryParams ASWeapon::GetShotQueryParams() const
 {
-	//Make anti cheat code here
-	return true;
+	FCollisionQueryParams QueryParams;
+	QueryParams.AddIgnoredActor(GetOwner());
+	QueryParams.AddIgnoredActor(this);
+	//Simple collision only, pawns are traced through their hitboxes
+	QueryParams.bTraceComplex = false;
+	QueryParams.bReturnPhysicalMaterial = true;
+	return QueryParams;
 }
 
 
-void ASWeapon::StartFire()
+bool ASWeapon::TraceShot(const FVector& EyeLocation, const FVector& ShotDirection, FHitResult& OutHit, float RewindTime) const
+{
+	FVector TraceEnd = EyeLocation + (ShotDirection * MaxShotRange);
+
+	FCollisionQueryParams QueryParams = GetShotQueryParams();
+
+	if (DebugWeaponDrawing > 0)
+	{
+		//If debugging is enabled by the console then draw debug lines for the weapon
+		DrawDebugLine(GetWorld(), EyeLocation, TraceEnd, FColor::White, false, 1.0f, 0, 1.0f);
+	}
+
+	//Client shots hit pawns where the client saw them
+	ASLagCompensation* LagCompensation = ASWorldManager::Get<ASLagCompensation>(this, false);
+	bool bHit = LagCompensation ? LagCompensation->LineTraceShot(OutHit, EyeLocation, TraceEnd, COLLISION_WEAPON, QueryParams, RewindTime)
+		: GetWorld()->LineTraceSingleByChannel(OutHit, EyeLocation, TraceEnd, COLLISION_WEAPON, QueryParams);
+
+	if (bHit)
+	{
+		RefineImpactSurface(EyeLocation, ShotDirection, OutHit);
+	}
+
+	return bHit;
+}
+
+
+void ASWeapon::RefineImpactSurface(const FVector& EyeLocation, const FVector& ShotDirection, FHitResult& InOutHit) const
 {
-	float FirstDelay = FMath::Max(LastFireTime + TimeBetweenShots - GetWorld()->TimeSeconds, 0.0f);
+	//Damage only needs simple collision. Impacts on the world that this machine shows get their exact polygon and surface
+	//from a short complex trace around the simple hit.
+	ASLagCompensation* LagCompensation = ASWorldManager::Get<ASLagCompensation>(this, false);
+	const bool bHitbox = LagCompensation && LagCompensation->GetHitbox(InOutHit);
+	if (bHitbox || ComplexSurfaceTrace <= 0 || GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_ComplexSurfaceTraces);
+
+	FCollisionQueryParams ComplexParams = GetShotQueryParams();
+	ComplexParams.bTraceComplex = true;
 
-	GetWorldTimerManager().SetTimer(TimerHandle_TimeBetweenShots, this, &ASWeapon::Fire, TimeBetweenShots, true, FirstDelay);
+	FHitResult ComplexHit;
+	const FVector SurfaceStart = InOutHit.ImpactPoint - ShotDirection * ComplexSurfaceMargin;
+	const FVector SurfaceEnd = InOutHit.ImpactPoint + ShotDirection * ComplexSurfaceMargin;
+	if (GetWorld()->LineTraceSingleByChannel(ComplexHit, SurfaceStart, SurfaceEnd, COLLISION_WEAPON, ComplexParams) && ComplexHit.GetActor() == InOutHit.GetActor())
+	{
+		InOutHit.Location = ComplexHit.Location;
+		InOutHit.ImpactPoint = ComplexHit.ImpactPoint;
+		InOutHit.Normal = ComplexHit.Normal;
+		InOutHit.ImpactNormal = ComplexHit.ImpactNormal;
+		InOutHit.PhysMaterial = ComplexHit.PhysMaterial;
+		InOutHit.FaceIndex = ComplexHit.FaceIndex;
+		InOutHit.Distance = (ComplexHit.Location - EyeLocation).Size();
+		InOutHit.Time = InOutHit.Distance / MaxShotRange;
+	}
 }
 
 
-void ASWeapon::StopFire()
+float ASWeapon::GetSpreadHalfAngle(uint8 SpreadFlags) const
 {
-	GetWorldTimerManager().ClearTimer(TimerHandle_TimeBetweenShots);
+	//Set the bullet spread acccording to the action that the character is doing
+	if (SpreadFlags & SHOTSPREAD_Aiming)
+	{
+		return FMath::DegreesToRadians(AimingBulletSpread);
+	}
+	else if (SpreadFlags & SHOTSPREAD_Crouched)
+	{
+		return FMath::DegreesToRadians(CrouchedBulletSpread);
+	}
+	else if (SpreadFlags & SHOTSPREAD_Moving)
+	{
+		return FMath::DegreesToRadians(MovingBulletSpread);
+	}
+
+	return FMath::DegreesToRadians(BulletSpread);
+}
+
+
+uint8 ASWeapon::GetSpreadFlags() const
+{
+	uint8 SpreadFlags = 0;
+	SpreadFlags |= IsAiming ? SHOTSPREAD_Aiming : 0;
+	SpreadFlags |= IsCrouched ? SHOTSPREAD_Crouched : 0;
+	SpreadFlags |= IsMoving ? SHOTSPREAD_Moving : 0;
+	return SpreadFlags;
+}
+
+
+void ASWeapon::AddHitScanTrace(const FHitScanTrace& Shot)
+{
+	const int32 Slot = HitScanBurst.BurstCounter % ARRAY_COUNT(HitScanBurst.Shots);
+	HitScanBurst.Shots[Slot] = Shot;
+	HitScanBurst.BurstCounter++;
+}
+
+
+void ASWeapon::PlayHitScanTrace(const FVector& EyeLocation, const FHitScanTrace& Shot)
+{
+	DispatchFireMode(FireMode, [&](auto Policy)
+	{
+		PlayHitScanTraceFor<decltype(Policy)>(EyeLocation, Shot);
+	});
+}
+
+
+template <typename FireModeType>
+void ASWeapon::PlayHitScanTraceFor(const FVector& EyeLocation, const FHitScanTrace& Shot)
+{
+	// One distance can't place every pellet, they are traced here for their effects only
+	if (FireModeType::bPellets)
+	{
+		FHitScanTrace PelletShot = Shot;
+		FirePellets(EyeLocation, PelletShot, -1.0f, false);
+		return;
+	}
+
+	// Rebuild the shot from the shooter's eyes, the server sent where along it the impact was
+	const FRotator AimRotation(FRotator::DecompressAxisFromShort(Shot.AimPitch), FRotator::DecompressAxisFromShort(Shot.AimYaw), 0.0f);
+	FVector ShotDirection = GetShotDirection(AimRotation, Shot.ShotIndex, Shot.GetSpreadFlags());
+
+	if (Shot.HitDistance == MAX_uint16)
+	{
+		PlayFireEffects(EyeLocation + (ShotDirection * MaxShotRange));
+		return;
+	}
+
+	FVector ImpactPoint = EyeLocation + ShotDirection * (Shot.HitDistance * MaxShotRange / (MAX_uint16 - 1));
+
+	PlayFireEffects(ImpactPoint);
+	PlayImpactEffects(Shot.GetSurfaceType(), ImpactPoint);
+}
+
+
+void ASWeapon::OnRep_HitScanBurst()
+{
+	const uint8 NumNewShots = HitScanBurst.BurstCounter - LastPlayedBurstCounter;
+	LastPlayedBurstCounter = HitScanBurst.BurstCounter;
+
+	// Shots fired before this client got the weapon are not played
+	AActor* MyOwner = GetOwner();
+	if (!HasActorBegunPlay() || MyOwner == nullptr)
+	{
+		return;
+	}
+
+	FVector EyeLocation;
+	FRotator EyeRotation;
+	MyOwner->GetActorEyesViewPoint(EyeLocation, EyeRotation);
+
+	// Oldest first, if more shots were fired than the buffer holds the oldest ones are gone
+	const int32 NumShotsToPlay = FMath::Min<int32>(NumNewShots, ARRAY_COUNT(HitScanBurst.Shots));
+	for (int32 i = NumShotsToPlay; i > 0; i--)
+	{
+		const uint8 Counter = HitScanBurst.BurstCounter - i;
+		PlayHitScanTrace(EyeLocation, HitScanBurst.Shots[Counter % ARRAY_COUNT(HitScanBurst.Shots)]);
+	}
+}
+
+
+void ASWeapon::StartFire()
+{
+	ASWeaponFireManager* FireManager = ASWorldManager::Get<ASWeaponFireManager>(this);
+	if (FireManager)
+	{
+		DispatchFireMode(FireMode, [&](auto Policy)
+		{
+			FireManager->StartFiring(this, LastFireTime + TimeBetweenShots, decltype(Policy)::GetShotsPerTrigger(BurstCount));
+		});
+	}
+}
+
+
+void ASWeapon::StopFire(bool bInterrupt)
+{
+	ASWeaponFireManager* FireManager = ASWorldManager::Get<ASWeaponFireManager>(this, false);
+	if (FireManager)
+	{
+		//Single shots and bursts finish by themselves, unless the weapon is put away
+		DispatchFireMode(FireMode, [&](auto Policy)
+		{
+			if (decltype(Policy)::bStopsOnRelease || bInterrupt)
+			{
+				FireManager->StopFiring(this);
+			}
+		});
+	}
+
+	if (Role < ROLE_Authority)
+	{
+		FlushPendingShots();
+		ServerStopFire(ShotCounter, CurrentAmmo);
+
+		//The server writes off whatever it did not get, nothing left to resend
+		UnackedShots.Reset();
+		UnackedFirstShotIndex = ShotCounter;
+	}
 }
 
 
+void ASWeapon::FireReplayShot(const FSReplayShot& Shot)
+{
+	//Built from the record alone, the shot index picks the same spread as long as the weapon got the same seed
+	FHitScanTrace Trace;
+	Trace.AimPitch = Shot.AimPitch;
+	Trace.AimYaw = Shot.AimYaw;
+	Trace.ShotIndex = Shot.ShotIndex;
+	Trace.SetSpreadAndSurface(Shot.SpreadFlags, SurfaceType_Default);
+
+	const float ShotAge = Shot.GetAge();
+	ProcessShot(Shot.EyeLocation, Trace, ShotAge > 0.0f ? GetWorld()->TimeSeconds - ShotAge : -1.0f);
+}
+
+
+void ASWeapon::RecordReplayShot(const FVector& EyeLocation, const FHitScanTrace& Shot, float ShotAge)
+{
+	ASReplayManager* ReplayManager = ASWorldManager::Get<ASReplayManager>(this, false);
+	if (ReplayManager == nullptr)
+	{
+		return;
+	}
+
+	FSReplayShot ReplayShot;
+	ReplayShot.EyeLocation = EyeLocation;
+	ReplayShot.SpreadSeed = SpreadSeed;
+	ReplayShot.AimPitch = Shot.AimPitch;
+	ReplayShot.AimYaw = Shot.AimYaw;
+	ReplayShot.ShotIndex = Shot.ShotIndex;
+	ReplayShot.SpreadFlags = Shot.GetSpreadFlags();
+	ReplayShot.SetAge(ShotAge);
+
+	ReplayManager->RecordShot(Cast<APawn>(GetOwner()), ReplayShot);
+}
+
+
+void ASWeapon::RecordReplayAmmo(ESReplayAmmoEvent Type)
+{
+	//Holstered weapons belong to the controller, their ammo is recorded when they are drawn
+	APawn* OwnerPawn = Cast<APawn>(GetOwner());
+	ASReplayManager* ReplayManager = OwnerPawn ? ASWorldManager::Get<ASReplayManager>(this, false) : nullptr;
+	if (ReplayManager)
+	{
+		ReplayManager->RecordAmmoEvent(OwnerPawn, Type, CurrentAmmo);
+	}
+}
+
+
 void ASWeapon::ReloadWeapon()
 {
 	AActor* MyOwner = GetOwner();
 	if (MyOwner)
 	{
 		CurrentAmmo = ClipSize;
+		ReloadCounter++;
+
+		if (Role == ROLE_Authority)
+		{
+			RecordReplayAmmo(ESReplayAmmoEvent::Reload);
+		}
+
+		//Predicted right away, the server reloads once it has the shots fired before
+		if (Role < ROLE_Authority)
+		{
+			FlushPendingShots();
+			ServerReloadWeapon(ShotCounter, ReloadCounter);
+
+			UnackedShots.Reset();
+			UnackedFirstShotIndex = ShotCounter;
+		}
 	}
 }
 
 
+void ASWeapon::Restock()
+{
+	const ASWeapon* Defaults = GetClass()->GetDefaultObject<ASWeapon>();
+	MaxAmmo = Defaults->MaxAmmo;
+	CurrentAmmo = Defaults->CurrentAmmo;
+
+	//Corrections from before the restock are ignored, like after a reload
+	ReloadCounter++;
+	ClientRestock(ReloadCounter, CurrentAmmo);
+
+	RecordReplayAmmo(ESReplayAmmoEvent::Restock);
+}
+
+
 void ASWeapon::PlayFireEffects(FVector TraceEnd)
 {
-	if (MuzzleEffect)
+	//Nobody sees or feels shots on a dedicated server
+	if (IsNetMode(NM_DedicatedServer))
 	{
-		UGameplayStatics::SpawnEmitterAttached(MuzzleEffect, MeshComp, MuzzleSocketName);
+		return;
 	}
 
-	if (TracerEffect)
+	if (MuzzleEffect)
 	{
-		FVector MuzzleLocation = MeshComp->GetSocketLocation(MuzzleSocketName);
-
-		UParticleSystemComponent* TracerComp = UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), TracerEffect, MuzzleLocation);
-		if (TracerComp)
-		{
-			TracerComp->SetVectorParameter(TracerTargetName, TraceEnd);
-		}
+		ASFXBudget::RequestEmitterAttached(MuzzleEffect, ESFXCategory::Muzzle, MeshComp, MuzzleSocketName);
 	}
 
+	PlayTracerEffect(TraceEnd);
+
 	APawn* MyOwner = Cast<APawn>(GetOwner());
 	if (MyOwner)
 	{
+		//Remote shots traced on the server don't shake the shooter's camera a second time
 		APlayerController* PC = Cast<APlayerController>(MyOwner->GetController());
-		if (PC)
+		if (PC && PC->IsLocalController())
 		{
 			PC->ClientPlayCameraShake(FireCamShake);
 		}
@@ -244,8 +940,29 @@ void ASWeapon::PlayFireEffects(FVector TraceEnd)
 }
 
 
+void ASWeapon::PlayTracerEffect(FVector TraceEnd)
+{
+	if (IsNetMode(NM_DedicatedServer))
+	{
+		return;
+	}
+
+	if (TracerEffect)
+	{
+		FVector MuzzleLocation = MeshComp->GetSocketLocation(MuzzleSocketName);
+
+		ASFXBudget::RequestEmitterAtLocation(this, TracerEffect, ESFXCategory::Tracer, MuzzleLocation, FRotator::ZeroRotator, TracerTargetName, TraceEnd);
+	}
+}
+
+
 void ASWeapon::PlayImpactEffects(EPhysicalSurface SurfaceType, FVector ImpactPoint)
 {
+	if (IsNetMode(NM_DedicatedServer))
+	{
+		return;
+	}
+
 	UParticleSystem* SelectedEffect = nullptr;
 	switch (SurfaceType)
 	{
@@ -265,7 +982,231 @@ void ASWeapon::PlayImpactEffects(EPhysicalSurface SurfaceType, FVector ImpactPoi
 		FVector ShotDirection = ImpactPoint - MuzzleLocation;
 		ShotDirection.Normalize();
 
-		UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), SelectedEffect, ImpactPoint, ShotDirection.Rotation());
+		ASFXBudget::RequestEmitterAtLocation(this, SelectedEffect, ESFXCategory::Impact, ImpactPoint, ShotDirection.Rotation());
+	}
+}
+
+
+// ------- ONLINE ------- \\
+
+void ASWeapon::FlushPendingShots()
+{
+	if (NumUnsentShots > 0)
+	{
+		//Nothing was waiting for an acknowledgement, the resend timer starts with these shots
+		if (UnackedShots.Num() == NumUnsentShots)
+		{
+			LastAckProgressTime = GetWorld()->TimeSeconds;
+		}
+
+		SendShots(UnackedShots.Num() - NumUnsentShots, NumUnsentShots);
+		NumUnsentShots = 0;
+	}
+}
+
+
+void ASWeapon::SendShots(int32 FirstUnackedShot, int32 NumShots)
+{
+	TArray<FSShotRecord> Shots(UnackedShots.GetData() + FirstUnackedShot, NumShots);
+	ServerFireBatch(Shots, UnackedFirstShotIndex + FirstUnackedShot, FirstUnackedShot == 0);
+
+	LastShotBatchTime = GetWorld()->TimeSeconds;
+}
+
+
+void ASWeapon::ServerFireBatch_Implementation(const TArray<FSShotRecord>& Shots, uint32 FirstShotIndex, bool bFromFirstUnacked)
+{
+	INC_DWORD_STAT(STAT_ShotBatchesReceived);
+	INC_DWORD_STAT_BY(STAT_ShotsReceived, Shots.Num());
+
+	AActor* MyOwner = GetOwner();
+	if (MyOwner == nullptr)
+	{
+		return;
+	}
+
+	if (FirstShotIndex > ServerShotIndex)
+	{
+		//An earlier batch got lost, wait for the client to resend from there so shots are traced in order
+		if (!bFromFirstUnacked)
+		{
+			return;
+		}
+
+		//The client expired the shots in between, they used up ammo like lost ones
+		ReconcileShots(FirstShotIndex);
+	}
+
+	const float ServerTime = GetServerTime();
+
+	//Fire budget is kept per player so swapping weapons does not reset it
+	APawn* OwnerPawn = Cast<APawn>(MyOwner);
+	ASPlayerState* OwnerPlayerState = OwnerPawn ? Cast<ASPlayerState>(OwnerPawn->PlayerState) : nullptr;
+	const float ShotsPerSecond = 1.0f / TimeBetweenShots;
+
+	FVector EyeLocation;
+	FRotator EyeRotation;
+	MyOwner->GetActorEyesViewPoint(EyeLocation, EyeRotation);
+
+	int32 NumTraced = 0;
+	bool bOutOfAmmo = false;
+
+	for (int32 i = 0; i < Shots.Num(); i++)
+	{
+		const FSShotRecord& Shot = Shots[i];
+
+		//Skip shots already traced, or written off by ServerStopFire
+		const uint32 ShotIndex = FirstShotIndex + i;
+		if (ShotIndex < ServerShotIndex)
+		{
+			continue;
+		}
+
+		//Shots over the fire budget or from batches that fell behind (or claim to come from the future) are not traced, the shot still costs ammo
+		const bool bInBudget = OwnerPlayerState == nullptr || OwnerPlayerState->ConsumeShotToken(ShotsPerSecond);
+		const bool bValidTime = Shot.Timestamp >= ServerTime - MaxShotAge && Shot.Timestamp <= ServerTime + MaxShotAge;
+		const bool bRejected = !bInBudget || !bValidTime || CurrentAmmo <= 0;
+		if (bRejected)
+		{
+			INC_DWORD_STAT(STAT_ShotsRejected);
+			bOutOfAmmo |= CurrentAmmo <= 0;
+		}
+		else
+		{
+			//Aim comes from the client, origin from the server's pawn
+			FHitScanTrace Trace;
+			Trace.AimPitch = Shot.AimPitch;
+			Trace.AimYaw = Shot.AimYaw;
+			Trace.ShotIndex = (uint16)ShotIndex;
+			Trace.SetSpreadAndSurface(Shot.SpreadFlags, SurfaceType_Default);
+
+			ProcessShot(EyeLocation, Trace, Shot.Timestamp);
+			RecordReplayShot(EyeLocation, Trace, ServerTime - Shot.Timestamp);
+			NumTraced++;
+
+			//Keep the server copy of the spread state in sync (read by replay input capture)
+			IsAiming = (Shot.SpreadFlags & SHOTSPREAD_Aiming) != 0;
+			IsCrouched = (Shot.SpreadFlags & SHOTSPREAD_Crouched) != 0;
+			IsMoving = (Shot.SpreadFlags & SHOTSPREAD_Moving) != 0;
+		}
+
+		CurrentAmmo = FMath::Max(CurrentAmmo - 1.0f, 0.0f);
+		ShotCounter++;
+		ServerShotIndex = ShotIndex + 1;
+
+		if (bRejected)
+		{
+			RecordReplayAmmo(ESReplayAmmoEvent::Spent);
+		}
+	}
+
+	if (NumTraced > 0)
+	{
+		LastFireTime = GetWorld()->TimeSeconds;
+	}
+
+	AckedShotIndex = ServerShotIndex;
+
+	//The client predicted shots with ammo the server did not have
+	if (bOutOfAmmo)
+	{
+		INC_DWORD_STAT(STAT_AmmoCorrections);
+		ClientCorrectAmmo(ServerShotIndex, ReloadCounter, CurrentAmmo);
+	}
+}
+
+
+bool ASWeapon::ServerFireBatch_Validate(const TArray<FSShotRecord>& Shots, uint32 FirstShotIndex, bool bFromFirstUnacked)
+{
+	return Shots.Num() <= MaxShotsPerBatch;
+}
+
+
+void ASWeapon::ServerStopFire_Implementation(uint32 ClientShotCounter, float ClientAmmo)
+{
+	ReconcileShots(ClientShotCounter);
+
+	if (ClientAmmo != CurrentAmmo)
+	{
+		INC_DWORD_STAT(STAT_AmmoCorrections);
+		ClientCorrectAmmo(ServerShotIndex, ReloadCounter, CurrentAmmo);
+	}
+}
+
+
+bool ASWeapon::ServerStopFire_Validate(uint32 ClientShotCounter, float ClientAmmo)
+{
+	return true;
+}
+
+
+void ASWeapon::ServerReloadWeapon_Implementation(uint32 ClientShotCounter, uint8 ClientReloadCounter)
+{
+	//Shots fired before the reload still come out of the old clip
+	ReconcileShots(ClientShotCounter);
+
+	CurrentAmmo = ClipSize;
+	ReloadCounter = ClientReloadCounter;
+
+	RecordReplayAmmo(ESReplayAmmoEvent::Reload);
+}
+
+
+bool ASWeapon::ServerReloadWeapon_Validate(uint32 ClientShotCounter, uint8 ClientReloadCounter)
+{
+	return true;
+}
+
+
+void ASWeapon::ReconcileShots(uint32 ClientShotCounter)
+{
+	//Batches that never arrived still used up ammo on the client
+	if (ClientShotCounter > ServerShotIndex)
+	{
+		const uint32 NumLost = ClientShotCounter - ServerShotIndex;
+		INC_DWORD_STAT_BY(STAT_ShotsLost, NumLost);
+
+		CurrentAmmo = FMath::Max(CurrentAmmo - NumLost, 0.0f);
+		ShotCounter += NumLost;
+		ServerShotIndex = ClientShotCounter;
+
+		RecordReplayAmmo(ESReplayAmmoEvent::Spent);
+
+		AckedShotIndex = ServerShotIndex;
+	}
+}
+
+
+void ASWeapon::ClientCorrectAmmo_Implementation(uint32 ShotIndex, uint8 ServerReloadCounter, float ServerAmmo)
+{
+	//The client reloaded since, the server catches up with that on its own
+	if (ServerReloadCounter != ReloadCounter)
+	{
+		return;
+	}
+
+	//Apply the shots predicted after ShotIndex on top of the server's ammo
+	CurrentAmmo = FMath::Max(ServerAmmo - (float)(ShotCounter - ShotIndex), 0.0f);
+}
+
+
+void ASWeapon::ClientRestock_Implementation(uint8 ServerReloadCounter, float ServerAmmo)
+{
+	ReloadCounter = ServerReloadCounter;
+	CurrentAmmo = ServerAmmo;
+	MaxAmmo = GetClass()->GetDefaultObject<ASWeapon>()->MaxAmmo;
+}
+
+
+void ASWeapon::OnRep_AckedShotIndex()
+{
+	//Acknowledged shots never have to be resent
+	const int32 NumAcked = FMath::Min((int32)(AckedShotIndex - UnackedFirstShotIndex), UnackedShots.Num() - NumUnsentShots);
+	if (NumAcked > 0)
+	{
+		UnackedShots.RemoveAt(0, NumAcked, false);
+		UnackedFirstShotIndex += NumAcked;
+		LastAckProgressTime = GetWorld()->TimeSeconds;
 	}
 }
 
@@ -274,5 +1215,7 @@ void ASWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetime
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME_CONDITION(ASWeapon, HitScanTrace, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(ASWeapon, HitScanBurst, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(ASWeapon, SpreadSeed, COND_InitialOnly);
+	DOREPLIFETIME_CONDITION(ASWeapon, AckedShotIndex, COND_OwnerOnly);
 }
@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SWeaponFireManager.h"
+#include "CoopGame.h"
+#include "SWeapon.h"
+#include "Engine/World.h"
+
+static int32 MaxShotsPerUpdate = 16;
+FAutoConsoleVariableRef CVARMaxShotsPerUpdate(
+	TEXT("COOP.MaxShotsPerUpdate"),
+	MaxShotsPerUpdate,
+	TEXT("Most shots a single weapon fires in one frame, the rest of a long hitch is skipped"),
+	ECVF_Default);
+
+DECLARE_CYCLE_STAT(TEXT("Weapon Fire Update"), STAT_WeaponFireUpdate, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Automatic Shots"), STAT_AutomaticShots, STATGROUP_CoopGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Sub-frame Shots"), STAT_SubFrameShots, STATGROUP_CoopGame);
+
+
+ASWeaponFireManager::ASWeaponFireManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	// After movement, so the last shot of the frame leaves from where the pawn ended up
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+}
+
+
+void ASWeaponFireManager::StartFiring(ASWeapon* Weapon, float FirstShotTime, int32 NumShots)
+{
+	AActor* MyOwner = Weapon ? Weapon->GetOwner() : nullptr;
+	if (MyOwner == nullptr || IsFiring(Weapon))
+	{
+		return;
+	}
+
+	const float Now = GetWorld()->TimeSeconds;
+
+	FFiringWeapon& Firing = FiringWeapons[FiringWeapons.AddDefaulted()];
+	Firing.Weapon = Weapon;
+	Firing.NextShotTime = FMath::Max(FirstShotTime, Now);
+	Firing.LastUpdateTime = Now;
+	Firing.ShotsRemaining = NumShots;
+	MyOwner->GetActorEyesViewPoint(Firing.LastEyeLocation, Firing.LastEyeRotation);
+
+	// A shot that is due now leaves right away, not at the end of the frame
+	if (Firing.NextShotTime <= Now)
+	{
+		INC_DWORD_STAT(STAT_AutomaticShots);
+
+		Weapon->FireAt(Firing.LastEyeLocation, Firing.LastEyeRotation, Now);
+		Firing.NextShotTime = Now + Weapon->GetTimeBetweenShots();
+
+		//A single shot is done already
+		if (Firing.ShotsRemaining > 0 && --Firing.ShotsRemaining == 0)
+		{
+			FiringWeapons.Pop(false);
+			return;
+		}
+	}
+
+	if (!IsActorTickEnabled())
+	{
+		SetActorTickEnabled(true);
+	}
+}
+
+
+void ASWeaponFireManager::StopFiring(ASWeapon* Weapon)
+{
+	for (int32 i = 0; i < FiringWeapons.Num(); i++)
+	{
+		if (FiringWeapons[i].Weapon.Get() == Weapon)
+		{
+			FiringWeapons.RemoveAtSwap(i);
+			return;
+		}
+	}
+}
+
+
+bool ASWeaponFireManager::IsFiring(const ASWeapon* Weapon) const
+{
+	for (const FFiringWeapon& Firing : FiringWeapons)
+	{
+		if (Firing.Weapon.Get() == Weapon)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void ASWeaponFireManager::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	SCOPE_CYCLE_COUNTER(STAT_WeaponFireUpdate);
+
+	const float Now = GetWorld()->TimeSeconds;
+
+	for (int32 i = FiringWeapons.Num() - 1; i >= 0; i--)
+	{
+		FFiringWeapon& Firing = FiringWeapons[i];
+
+		ASWeapon* Weapon = Firing.Weapon.Get();
+		AActor* MyOwner = Weapon ? Weapon->GetOwner() : nullptr;
+		if (MyOwner == nullptr)
+		{
+			FiringWeapons.RemoveAtSwap(i);
+			continue;
+		}
+
+		FVector EyeLocation;
+		FRotator EyeRotation;
+		MyOwner->GetActorEyesViewPoint(EyeLocation, EyeRotation);
+
+		const float TimeBetweenShots = FMath::Max(Weapon->GetTimeBetweenShots(), KINDA_SMALL_NUMBER);
+		const float UpdateDuration = Now - Firing.LastUpdateTime;
+
+		// After a long hitch only the latest shots are fired
+		Firing.NextShotTime = FMath::Max(Firing.NextShotTime, Now - TimeBetweenShots * (MaxShotsPerUpdate - 1));
+
+		bool bDone = false;
+		while (Firing.NextShotTime <= Now && !bDone)
+		{
+			// Where the owner was aiming when the shot came due, between the last update and this one
+			const float Alpha = UpdateDuration > 0.0f ? FMath::Clamp((Firing.NextShotTime - Firing.LastUpdateTime) / UpdateDuration, 0.0f, 1.0f) : 1.0f;
+			const FVector ShotEyeLocation = FMath::Lerp(Firing.LastEyeLocation, EyeLocation, Alpha);
+			const FRotator ShotEyeRotation = FQuat::Slerp(Firing.LastEyeRotation.Quaternion(), EyeRotation.Quaternion(), Alpha).Rotator();
+
+			INC_DWORD_STAT(STAT_AutomaticShots);
+			if (Firing.NextShotTime < Now)
+			{
+				INC_DWORD_STAT(STAT_SubFrameShots);
+			}
+
+			Weapon->FireAt(ShotEyeLocation, ShotEyeRotation, Firing.NextShotTime);
+			Firing.NextShotTime += TimeBetweenShots;
+
+			bDone = Firing.ShotsRemaining > 0 && --Firing.ShotsRemaining == 0;
+		}
+
+		if (bDone)
+		{
+			FiringWeapons.RemoveAtSwap(i);
+			continue;
+		}
+
+		Firing.LastEyeLocation = EyeLocation;
+		Firing.LastEyeRotation = EyeRotation;
+		Firing.LastUpdateTime = Now;
+	}
+
+	if (FiringWeapons.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+	}
+}
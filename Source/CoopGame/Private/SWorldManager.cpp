@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SWorldManager.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+
+
+TMap<TPair<const UWorld*, const UClass*>, TWeakObjectPtr<ASWorldManager>> ASWorldManager::Managers;
+
+
+ASWorldManager::ASWorldManager()
+{
+	// Managers decide themselves if and when they tick
+	PrimaryActorTick.bCanEverTick = false;
+
+	SetReplicates(false);
+}
+
+
+void ASWorldManager::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	Managers.Add(MakeTuple(static_cast<const UWorld*>(GetWorld()), static_cast<const UClass*>(GetClass())), this);
+}
+
+
+void ASWorldManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Managers.Remove(MakeTuple(static_cast<const UWorld*>(GetWorld()), static_cast<const UClass*>(GetClass())));
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
+ASWorldManager* ASWorldManager::GetOrCreate(const UObject* WorldContextObject, UClass* ManagerClass, bool bCreateIfMissing)
+{
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull);
+	if (World == nullptr || !World->IsGameWorld() || World->bIsTearingDown)
+	{
+		return nullptr;
+	}
+
+	const TPair<const UWorld*, const UClass*> Key = MakeTuple(static_cast<const UWorld*>(World), static_cast<const UClass*>(ManagerClass));
+
+	TWeakObjectPtr<ASWorldManager>* Existing = Managers.Find(Key);
+	if (Existing && Existing->IsValid())
+	{
+		return Existing->Get();
+	}
+
+	if (!bCreateIfMissing)
+	{
+		return nullptr;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+
+	// Registers itself in PostInitializeComponents
+	return World->SpawnActor<ASWorldManager>(ManagerClass, SpawnParams);
+}
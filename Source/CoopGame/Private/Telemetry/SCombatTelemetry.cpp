@@ -0,0 +1,306 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SCombatTelemetry.h"
+#include "SHealthComponent.h"
+#include "GameFramework/Actor.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Misc/CommandLine.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+static int32 CombatTelemetryEnabled = 0;
+FAutoConsoleVariableRef CVARCombatTelemetry(
+	TEXT("COOP.Telemetry"),
+	CombatTelemetryEnabled,
+	TEXT("Write combat events (damage, heal, kill, spawn, explosion, wave state) to Saved/Telemetry"),
+	ECVF_Default);
+
+
+/* Background thread that drains the telemetry ring buffer to disk */
+class FSCombatTelemetryWriter : public FRunnable
+{
+public:
+
+	FSCombatTelemetryWriter(FSCombatTelemetry& InTelemetry, const FString& InFilename)
+		: Telemetry(InTelemetry), Filename(InFilename)
+	{
+	}
+
+	virtual uint32 Run() override
+	{
+		TUniquePtr<FArchive> FileWriter(IFileManager::Get().CreateFileWriter(*Filename));
+		if (!FileWriter.IsValid())
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to open combat telemetry file %s"), *Filename);
+			return 1;
+		}
+
+		FSTelemetryFileHeader Header;
+		Header.Magic = STELEMETRY_MAGIC;
+		Header.Version = STELEMETRY_VERSION;
+		Header.RecordSize = sizeof(FSTelemetryRecord);
+		Header.StartTime = FDateTime::UtcNow().GetTicks();
+		FileWriter->Serialize(&Header, sizeof(Header));
+
+		while (!bStopRequested)
+		{
+			Drain(*FileWriter);
+
+			FPlatformProcess::Sleep(0.01f);
+		}
+
+		// Pick up whatever was pushed while we were asked to stop
+		Drain(*FileWriter);
+
+		FileWriter->Close();
+		return 0;
+	}
+
+	virtual void Stop() override
+	{
+		bStopRequested = true;
+	}
+
+private:
+
+	void Drain(FArchive& FileWriter)
+	{
+		FSTelemetryRecord Record;
+		while (Telemetry.Pop(Record))
+		{
+			Batch.Add(Record);
+
+			if (Batch.Num() == BatchSize)
+			{
+				FileWriter.Serialize(Batch.GetData(), Batch.Num() * sizeof(FSTelemetryRecord));
+				Batch.Reset();
+			}
+		}
+
+		if (Batch.Num() > 0)
+		{
+			FileWriter.Serialize(Batch.GetData(), Batch.Num() * sizeof(FSTelemetryRecord));
+			Batch.Reset();
+		}
+
+		FileWriter.Flush();
+	}
+
+	static const int32 BatchSize = 1024;
+
+	FSCombatTelemetry& Telemetry;
+
+	FString Filename;
+
+	TArray<FSTelemetryRecord, TInlineAllocator<BatchSize>> Batch;
+
+	FThreadSafeBool bStopRequested;
+};
+
+
+static FCriticalSection WriterCritical;
+
+
+FSCombatTelemetry::FSCombatTelemetry()
+	: EnqueuePos(0), DequeuePos(0), NrOfDroppedRecords(0), WriterState(WRITER_NotStarted), Writer(nullptr), WriterThread(nullptr)
+{
+	Slots = new FSlot[Capacity];
+	for (uint32 i = 0; i < Capacity; i++)
+	{
+		Slots[i].Sequence = i;
+	}
+
+	// Once for the whole process, the instance lives until exit
+	FCoreDelegates::OnPreExit.AddStatic(&FSCombatTelemetry::Shutdown);
+}
+
+
+FSCombatTelemetry::~FSCombatTelemetry()
+{
+	StopWriter();
+
+	delete[] Slots;
+}
+
+
+FSCombatTelemetry& FSCombatTelemetry::Get()
+{
+	static FSCombatTelemetry Instance;
+	return Instance;
+}
+
+
+bool FSCombatTelemetry::IsEnabled()
+{
+	static const bool bEnabledOnCommandLine = FParse::Param(FCommandLine::Get(), TEXT("CombatTelemetry"));
+
+	return CombatTelemetryEnabled > 0 || bEnabledOnCommandLine;
+}
+
+
+void FSCombatTelemetry::Record(ESTelemetryEvent Type, const AActor* Subject, const AActor* Other, float Value, float Value2)
+{
+	if (!IsEnabled())
+	{
+		return;
+	}
+
+	FSCombatTelemetry& Telemetry = Get();
+	const uint8 State = Telemetry.WriterState.Load();
+	if (State == WRITER_ShutDown || (State == WRITER_NotStarted && !Telemetry.StartWriter()))
+	{
+		return;
+	}
+
+	FSTelemetryRecord Record;
+	FMemory::Memzero(Record);
+
+	const AActor* WorldContext = Subject ? Subject : Other;
+	UWorld* World = WorldContext ? WorldContext->GetWorld() : nullptr;
+
+	Record.Time = World ? World->TimeSeconds : 0.0f;
+	Record.Frame = (uint32)GFrameCounter;
+	Record.Type = (uint8)Type;
+	Record.Value = Value;
+	Record.Value2 = Value2;
+
+	if (Subject)
+	{
+		Record.SubjectId = Subject->GetUniqueID();
+
+		USHealthComponent* HealthComp = USHealthComponent::FindHealthComponent(Subject);
+		Record.SubjectTeam = HealthComp ? HealthComp->TeamNum : 255;
+
+		FVector Location = Subject->GetActorLocation();
+		Record.Location[0] = Location.X;
+		Record.Location[1] = Location.Y;
+		Record.Location[2] = Location.Z;
+	}
+
+	if (Other)
+	{
+		Record.OtherId = Other->GetUniqueID();
+
+		USHealthComponent* HealthComp = USHealthComponent::FindHealthComponent(Other);
+		Record.OtherTeam = HealthComp ? HealthComp->TeamNum : 255;
+	}
+
+	Telemetry.Push(Record);
+}
+
+
+void FSCombatTelemetry::Shutdown()
+{
+	Get().StopWriter();
+}
+
+
+bool FSCombatTelemetry::Push(const FSTelemetryRecord& Record)
+{
+	FSlot* Slot = nullptr;
+
+	uint32 Pos = EnqueuePos.Load();
+	for (;;)
+	{
+		Slot = &Slots[Pos & (Capacity - 1)];
+
+		int32 Diff = (int32)(Slot->Sequence.Load() - Pos);
+		if (Diff == 0)
+		{
+			// Slot is free, try to claim it (Pos is refreshed when another producer beat us to it)
+			if (EnqueuePos.CompareExchange(Pos, Pos + 1))
+			{
+				break;
+			}
+		}
+		else if (Diff < 0)
+		{
+			// Buffer is full, the writer can't keep up
+			NrOfDroppedRecords++;
+			return false;
+		}
+		else
+		{
+			Pos = EnqueuePos.Load();
+		}
+	}
+
+	Slot->Record = Record;
+	Slot->Sequence.Store(Pos + 1);
+
+	return true;
+}
+
+
+bool FSCombatTelemetry::Pop(FSTelemetryRecord& OutRecord)
+{
+	FSlot& Slot = Slots[DequeuePos & (Capacity - 1)];
+
+	if ((int32)(Slot.Sequence.Load() - (DequeuePos + 1)) < 0)
+	{
+		// Empty
+		return false;
+	}
+
+	OutRecord = Slot.Record;
+	Slot.Sequence.Store(DequeuePos + Capacity);
+
+	DequeuePos++;
+
+	return true;
+}
+
+
+bool FSCombatTelemetry::StartWriter()
+{
+	FScopeLock Lock(&WriterCritical);
+
+	// Another thread got here first, or the process is on its way out
+	if (WriterState.Load() != WRITER_NotStarted)
+	{
+		return WriterState.Load() == WRITER_Running;
+	}
+
+	FString Filename = FPaths::ProjectSavedDir() / TEXT("Telemetry") / FString::Printf(TEXT("Combat-%s-%u.ctel"),
+		*FDateTime::Now().ToString(), FPlatformProcess::GetCurrentProcessId());
+
+	Writer = new FSCombatTelemetryWriter(*this, Filename);
+	WriterThread = FRunnableThread::Create(Writer, TEXT("CombatTelemetryWriter"), 0, TPri_BelowNormal);
+	WriterState.Store(WRITER_Running);
+
+	UE_LOG(LogTemp, Log, TEXT("Writing combat telemetry to %s"), *Filename);
+	return true;
+}
+
+
+void FSCombatTelemetry::StopWriter()
+{
+	FScopeLock Lock(&WriterCritical);
+
+	// Records still in flight land in the ring buffer and are never written, nothing reads the writer outside the lock
+	WriterState.Store(WRITER_ShutDown);
+
+	if (WriterThread)
+	{
+		WriterThread->Kill(true);
+		delete WriterThread;
+		WriterThread = nullptr;
+	}
+
+	if (Writer)
+	{
+		delete Writer;
+		Writer = nullptr;
+
+		uint32 NrOfDropped = NrOfDroppedRecords.Load();
+		if (NrOfDropped > 0)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Combat telemetry dropped %u events, the writer could not keep up"), NrOfDropped);
+		}
+	}
+}
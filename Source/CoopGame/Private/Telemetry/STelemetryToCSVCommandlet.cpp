@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "STelemetryToCSVCommandlet.h"
+#include "SCombatTelemetry.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+
+
+USTelemetryToCSVCommandlet::USTelemetryToCSVCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+
+int32 USTelemetryToCSVCommandlet::Main(const FString& Params)
+{
+	FString InFile;
+	if (!FParse::Value(*Params, TEXT("In="), InFile))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Usage: -run=STelemetryToCSV -In=<file.ctel> [-Out=<file.csv>]"));
+		return 1;
+	}
+
+	FString OutFile;
+	if (!FParse::Value(*Params, TEXT("Out="), OutFile))
+	{
+		OutFile = FPaths::ChangeExtension(InFile, TEXT("csv"));
+	}
+
+	// Map the file and read the records in place, fall back to loading it when mapping isn't supported
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	TUniquePtr<IMappedFileHandle> MappedFile(PlatformFile.OpenMapped(*InFile));
+	TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile.IsValid() ? MappedFile->MapRegion() : nullptr);
+
+	TArray<uint8> FileData;
+	const uint8* Data = nullptr;
+	int64 DataSize = 0;
+
+	if (MappedRegion.IsValid())
+	{
+		Data = MappedRegion->GetMappedPtr();
+		DataSize = MappedRegion->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(FileData, *InFile))
+	{
+		Data = FileData.GetData();
+		DataSize = FileData.Num();
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to read %s"), *InFile);
+		return 1;
+	}
+
+	const FSTelemetryFileHeader* Header = reinterpret_cast<const FSTelemetryFileHeader*>(Data);
+	if (DataSize < (int64)sizeof(FSTelemetryFileHeader) || Header->Magic != STELEMETRY_MAGIC || Header->Version != STELEMETRY_VERSION
+		|| Header->RecordSize != sizeof(FSTelemetryRecord))
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s is not a combat telemetry file this build can read"), *InFile);
+		return 1;
+	}
+
+	const FSTelemetryRecord* Records = reinterpret_cast<const FSTelemetryRecord*>(Data + sizeof(FSTelemetryFileHeader));
+	const int64 NrOfRecords = (DataSize - sizeof(FSTelemetryFileHeader)) / sizeof(FSTelemetryRecord);
+
+	static const TCHAR* EventNames[] = { TEXT("Damage"), TEXT("Heal"), TEXT("Kill"), TEXT("Spawn"), TEXT("Explosion"), TEXT("WaveState") };
+
+	TArray<FString> Lines;
+	Lines.Reserve(NrOfRecords + 1);
+	Lines.Add(TEXT("Time,Frame,Event,SubjectId,SubjectTeam,OtherId,OtherTeam,Value,Value2,X,Y,Z"));
+
+	for (int64 i = 0; i < NrOfRecords; i++)
+	{
+		const FSTelemetryRecord& Record = Records[i];
+		const TCHAR* EventName = Record.Type < ARRAY_COUNT(EventNames) ? EventNames[Record.Type] : TEXT("Unknown");
+
+		Lines.Add(FString::Printf(TEXT("%.3f,%u,%s,%u,%u,%u,%u,%g,%g,%.1f,%.1f,%.1f"),
+			Record.Time, Record.Frame, EventName, Record.SubjectId, Record.SubjectTeam, Record.OtherId, Record.OtherTeam,
+			Record.Value, Record.Value2, Record.Location[0], Record.Location[1], Record.Location[2]));
+	}
+
+	if (!FFileHelper::SaveStringArrayToFile(Lines, *OutFile))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to write %s"), *OutFile);
+		return 1;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Converted %lld combat events to %s"), NrOfRecords, *OutFile);
+	return 0;
+}
@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Pawn.h"
+#include "SEffectScheduler.h"
+#include "SHitbox.h"
 #include "STrackerBot.generated.h"
 
 class USHealthComponent;
@@ -50,6 +52,10 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "TrackerBot")
 	float RequiredDistanceToTarget;
 
+	/* Shapes weapon shots are traced against, relative to the bot */
+	UPROPERTY(EditDefaultsOnly, Category = "TrackerBot")
+	TArray<FSHitbox> Hitboxes;
+
 	// Dynamic material to pulse on damage
 	UMaterialInstanceDynamic* MatInst;
 
@@ -72,7 +78,7 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "TrackerBot")
 	float SelfDamageInterval;
 
-	FTimerHandle TimerHandle_SelfDamage;
+	FSEffectHandle SelfDamageEffect;
 
 	void DamageSelf();
 
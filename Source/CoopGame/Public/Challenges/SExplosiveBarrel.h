@@ -43,6 +43,13 @@ protected:
 	UFUNCTION()
 	void OnRep_Exploded();
 
+	/* Barrels stay dormant while their physics sleeps and only replicate movement while simulating */
+	UFUNCTION()
+	void OnMeshWake(UPrimitiveComponent* WakingComponent, FName BoneName);
+
+	UFUNCTION()
+	void OnMeshSleep(UPrimitiveComponent* SleepingComponent, FName BoneName);
+
 	/* Impulse applied to the barrel mesh when it explodes to boost it up a little */
 	UPROPERTY(EditDefaultsOnly, Category = "FX")
 	float ExplosionImpulse;
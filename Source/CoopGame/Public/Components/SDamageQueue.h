@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SWorldManager.h"
+#include "SDamageQueue.generated.h"
+
+class USHealthComponent;
+
+
+/**
+ * Collects the health components that took damage during the frame and applies all their hits in one pass at the end of it,
+ * so every damaged actor gets a single health update, OnHealthChanged broadcast and death check per frame.
+ * Damage caused while applying (eg. exploding bots) is applied in the same pass.
+ */
+UCLASS()
+class COOPGAME_API ASDamageQueue : public ASWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	ASDamageQueue();
+
+	/* Queue a component that received its first hit this frame */
+	void Enqueue(USHealthComponent* HealthComp);
+
+	/* Apply all queued damage now */
+	void Flush();
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	/* Is damage coalescing enabled (COOP.CoalesceDamage) */
+	static bool IsEnabled();
+
+protected:
+
+	TArray<TWeakObjectPtr<USHealthComponent>> QueuedComponents;
+
+	TArray<TWeakObjectPtr<USHealthComponent>> ComponentsToApply;
+};
@@ -9,6 +9,20 @@
 // OnHealthChanged event
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_SixParams(FOnHealthChangedSignature, USHealthComponent*, OwningHealthComp, float, Health, float, HealthDelta, const class UDamageType*, DamageType, class AController*, InstigatedBy, AActor*, DamageCauser);
 
+
+// Hit received during the frame, waiting to be applied by the damage queue
+struct FSQueuedDamage
+{
+	float Damage;
+
+	const class UDamageType* DamageType;
+
+	TWeakObjectPtr<class AController> InstigatedBy;
+
+	TWeakObjectPtr<AActor> DamageCauser;
+};
+
+
 UCLASS( ClassGroup=(COOP), meta=(BlueprintSpawnableComponent) )
 class COOPGAME_API USHealthComponent : public UActorComponent
 {
@@ -25,6 +39,11 @@ protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
+	// Registers the owner in the team registry for O(1) IsFriendly lookups
+	virtual void OnRegister() override;
+
+	virtual void OnUnregister() override;
+
 	bool bIsDead;
 
 	UPROPERTY(ReplicatedUsing=OnRep_Health, BlueprintReadOnly, Category = "HealthComponent")
@@ -38,9 +57,15 @@ protected:
 
 	UFUNCTION()
 	void HandleTakeAnyDamage(AActor* DamagedActor, float Damage, const class UDamageType* DamageType, class AController* InstigatedBy, AActor* DamageCauser);
+
+	// Hits of this frame in the order they arrived
+	TArray<FSQueuedDamage, TInlineAllocator<4>> QueuedDamage;
 	
 public:
 
+	/* Applies all hits received this frame with a single health update, OnHealthChanged broadcast and death check */
+	void ApplyQueuedDamage();
+
 	float GetHealth() const;
 
 	UPROPERTY(BlueprintAssignable, Category = "Events")
@@ -51,4 +76,11 @@ public:
 
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "HealthComponent")
 	static bool IsFriendly(AActor* ActorA, AActor* ActorB);
+
+	/* Set if two teams are friendly to each other, by default only members of the same team are */
+	UFUNCTION(BlueprintCallable, Category = "HealthComponent")
+	static void SetTeamsFriendly(uint8 TeamA, uint8 TeamB, bool bFriendly);
+
+	/* Health component of an actor without searching its components */
+	static USHealthComponent* FindHealthComponent(const AActor* Actor);
 };
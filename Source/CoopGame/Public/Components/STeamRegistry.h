@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+
+class USHealthComponent;
+
+
+/**
+ * Constant time lookup of an actor's health component (and so its team), indexed by the actor's UObject index.
+ * Health components in game worlds register their owner when they are registered and remove it again when unregistered.
+ * The table is freed once nothing is registered anymore, so it does not keep editor sized object indices between sessions.
+ *
+ * Friend or foe between two teams is resolved through a 256x256 relationship bit matrix (same team = friendly by default).
+ * Relationships go back to the defaults whenever a game world is cleaned up, such as at the end of a PIE session or on map change.
+ */
+class COOPGAME_API FSTeamRegistry
+{
+public:
+
+	static void Register(const AActor* Actor, USHealthComponent* HealthComp);
+
+	static void Unregister(const AActor* Actor, USHealthComponent* HealthComp);
+
+	static FORCEINLINE USHealthComponent* FindHealthComponent(const AActor* Actor)
+	{
+		const int32 Index = Actor->GetUniqueID();
+		return HealthComponents.IsValidIndex(Index) ? HealthComponents[Index] : nullptr;
+	}
+
+	static FORCEINLINE bool AreTeamsFriendly(uint8 TeamA, uint8 TeamB)
+	{
+		return (FriendlyMatrix.Bits[TeamA][TeamB >> 5] & (1u << (TeamB & 31))) != 0;
+	}
+
+	/* Changes the relationship of two teams (both directions) */
+	static void SetTeamsFriendly(uint8 TeamA, uint8 TeamB, bool bFriendly);
+
+private:
+
+	static void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources);
+
+	struct FTeamMatrix
+	{
+		uint32 Bits[256][8];
+
+		FTeamMatrix();
+	};
+
+	// Indexed by UObject internal index of the owning actor
+	static TArray<USHealthComponent*> HealthComponents;
+
+	static int32 NumRegistered;
+
+	static FDelegateHandle WorldCleanupHandle;
+
+	static FTeamMatrix FriendlyMatrix;
+};
@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/ActorChannel.h"
+#include "SLoadTestActorChannel.generated.h"
+
+class ASLoadTestReporter;
+
+
+/**
+ * Actor channel that reports every bunch it sends to the load test reporter, so the report has the bits each class costs.
+ * Only used on a server measuring a load test, the reporter swaps it in for new actor channels when it starts.
+ */
+UCLASS(Transient)
+class COOPGAME_API USLoadTestActorChannel : public UActorChannel
+{
+	GENERATED_BODY()
+
+public:
+
+	USLoadTestActorChannel(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	virtual FPacketIdRange SendBunch(FOutBunch* Bunch, bool Merge) override;
+
+protected:
+
+	TWeakObjectPtr<ASLoadTestReporter> Reporter;
+};
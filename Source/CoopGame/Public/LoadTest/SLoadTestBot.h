@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SWorldManager.h"
+#include "InputCoreTypes.h"
+#include "SLoadTestBot.generated.h"
+
+class APlayerController;
+
+
+/**
+ * Scripted input for headless load test clients (-LoadTestBot).
+ * Presses the same keys and mouse axes a player would through the local player controller, so every input binding,
+ * movement prediction and weapon RPC path is exercised exactly as in a real session.
+ *
+ * The bot alternates between random phases of walking, sprinting, aiming and firing bursts while turning.
+ * -LoadTestSeed=<n> makes a client's input sequence reproducible.
+ */
+UCLASS()
+class COOPGAME_API ASLoadTestBot : public ASWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	ASLoadTestBot();
+
+	/* Starts the bot on clients launched with -LoadTestBot. Called by the game state when play begins. */
+	static void StartFromCommandLine(const UObject* WorldContextObject);
+
+	virtual void Tick(float DeltaSeconds) override;
+
+protected:
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/* Picks the keys to hold and the look rate for the next phase */
+	void StartNextPhase();
+
+	void SetKeyDown(APlayerController* PC, const FKey& Key, bool bDown);
+
+	void ReleaseAllKeys();
+
+	FRandomStream RandomStream;
+
+	// Keys currently held down
+	TArray<FKey> PressedKeys;
+
+	// Keys to hold during the current phase
+	TArray<FKey> PhaseKeys;
+
+	float PhaseTimeRemaining;
+
+	// Mouse delta per second during the current phase
+	FVector2D LookRate;
+
+	// Fire is pressed and released in bursts while a fire phase is active
+	bool bFirePhase;
+
+	float BurstTimeRemaining;
+};
@@ -0,0 +1,154 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SWorldManager.h"
+#include "SLoadTestReporter.generated.h"
+
+class UNetConnection;
+
+
+/* Traffic of a single client connection over the whole test */
+struct FSLoadTestConnectionStats
+{
+	FString Address;
+
+	FString PlayerName;
+
+	int64 TotalInBytes;
+
+	int64 TotalOutBytes;
+
+	int32 PeakInBytesPerSecond;
+
+	int32 PeakOutBytesPerSecond;
+
+	double TotalPing;
+
+	int32 TotalPacketsLost;
+
+	int32 NumSamples;
+
+	FSLoadTestConnectionStats()
+		: TotalInBytes(0), TotalOutBytes(0), PeakInBytesPerSecond(0), PeakOutBytesPerSecond(0), TotalPing(0.0), TotalPacketsLost(0), NumSamples(0)
+	{
+	}
+};
+
+
+/* Replicated actors of one class, sampled once per second, and what they sent to all connections */
+struct FSLoadTestClassStats
+{
+	int32 PeakCount;
+
+	int64 TotalCount;
+
+	float NetUpdateFrequency;
+
+	// Bunch bits sent by actor channels of this class, properties and RPCs
+	int64 TotalBits;
+
+	int32 NumBunches;
+
+	FSLoadTestClassStats()
+		: PeakCount(0), TotalCount(0), NetUpdateFrequency(0.0f), TotalBits(0), NumBunches(0)
+	{
+	}
+};
+
+
+/**
+ * Server side half of the network load harness (Scripts/LoadTest.py).
+ * Started with -LoadTest on a dedicated server; samples every client connection's traffic once per second,
+ * records server frame and game thread times every frame, and counts replicated actors per class.
+ * Actor channels opened during the test are USLoadTestActorChannel, they add the bits every class sends to the report.
+ * On dedicated servers the report also checks that no cosmetic objects (effects, sounds, dynamic materials) were created.
+ *
+ * Cost per property is captured by the engine network profiler for the duration of the test.
+ * After -LoadTestDuration=<seconds> (default 120) the report is written to -LoadTestReport=<file> and the server exits.
+ */
+UCLASS()
+class COOPGAME_API ASLoadTestReporter : public ASWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	ASLoadTestReporter();
+
+	/* Starts measuring on servers launched with -LoadTest. Called by the game state when play begins. */
+	static void StartFromCommandLine(const UObject* WorldContextObject);
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	/* A bunch sent for an actor of ActorClass, called by USLoadTestActorChannel */
+	void AddReplicationCost(const UClass* ActorClass, int64 NumBits);
+
+protected:
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	void StartMeasuring();
+
+	void SampleConnections();
+
+	void SampleClasses();
+
+	/* Effect, sound and dynamic material objects made since measuring started, a dedicated server should never make any */
+	void SampleCosmetics();
+
+	void CountCosmetics(int32& OutParticleComponents, int32& OutAudioComponents, int32& OutDynamicMaterials) const;
+
+	void WriteReport();
+
+	/* Frame time in ms at the given percentile (0..1) of the histogram */
+	float GetFrameTimePercentile(const TArray<int32>& Histogram, float Percentile) const;
+
+	TMap<UNetConnection*, FSLoadTestConnectionStats> ConnectionStats;
+
+	// Connections that closed during the test, kept for the report
+	TArray<FSLoadTestConnectionStats> ClosedConnectionStats;
+
+	TMap<FName, FSLoadTestClassStats> ClassStats;
+
+	// Cosmetic objects that came with the map, counted when measuring starts
+	int32 BaseParticleComponents;
+
+	int32 BaseAudioComponents;
+
+	int32 BaseDynamicMaterials;
+
+	int32 PeakParticleComponents;
+
+	int32 PeakAudioComponents;
+
+	int32 PeakDynamicMaterials;
+
+	// Frame and game thread time histograms in 0.5ms buckets
+	TArray<int32> FrameTimeHistogram;
+
+	TArray<int32> GameThreadTimeHistogram;
+
+	double TotalTickTime;
+
+	float MaxTickTime;
+
+	int32 NumFrames;
+
+	int32 NumSamples;
+
+	int32 PeakNumConnections;
+
+	float SampleTimeRemaining;
+
+	float TestTimeRemaining;
+
+	float TestDuration;
+
+	FString ReportFilename;
+
+	bool bMeasuring;
+
+	bool bReportWritten;
+};
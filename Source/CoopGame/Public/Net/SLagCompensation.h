@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SWorldManager.h"
+#include "SHitbox.h"
+#include "SLagCompensation.generated.h"
+
+class APawn;
+class USkeletalMeshComponent;
+
+
+/**
+ * Traces weapon shots against registered pawns (players and tracker bots), through their hitboxes where they have them.
+ *
+ * On servers it also keeps a history of where every registered pawn was over the last half second,
+ * so shots from clients are traced against the world as the shooter saw it.
+ *
+ * Transforms are recorded once per server tick into a fixed size ring, stored as separate arrays per field
+ * ([Frame * MaxPawns + PawnSlot]) with one shared timestamp per frame. A rewind binary searches the timestamps once
+ * and interpolates between the two frames around the requested time. Pawns are never moved, the shot ray is moved
+ * into each pawn's current frame instead.
+ */
+UCLASS()
+class COOPGAME_API ASLagCompensation : public ASWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	ASLagCompensation();
+
+	/**
+	 * Registers the pawn on every machine, and starts recording its history on servers.
+	 * Hitboxes point at the pawn's own hitbox array, it is traced instead of the pawn's collision when not empty.
+	 * The slot frees itself when the pawn is destroyed.
+	 */
+	void RegisterPawn(APawn* Pawn, const TArray<FSHitbox>* Hitboxes = nullptr);
+
+	/**
+	 * Line trace against the world and the registered pawns. With a RewindTime (server world time, negative for now)
+	 * the pawns are moved back to where they were at that time.
+	 */
+	bool LineTraceShot(FHitResult& OutHit, const FVector& Start, const FVector& End, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params, float RewindTime = -1.0f);
+
+	/* Only the registered pawns part of LineTraceShot. OutHit is only written if a pawn is hit before MaxTime */
+	bool LineTracePawns(FHitResult& OutHit, const FVector& Start, const FVector& End, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params, float RewindTime, float MaxTime = 1.0f);
+
+	/**
+	 * LineTraceShot for a spread of rays from one Start, such as the pellets of a shotgun, as one query. Every pawn is rewound
+	 * once and tested against all rays that pass close to it. OutHits has one entry per end, bBlockingHit tells if that ray hit.
+	 * Returns the number of rays that hit something.
+	 */
+	int32 LineTraceShots(TArray<FHitResult>& OutHits, const FVector& Start, const TArray<FVector>& Ends, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params, float RewindTime = -1.0f);
+
+	/* For world traces that leave the registered pawns to LineTracePawns */
+	void AddIgnoredPawns(FCollisionQueryParams& Params) const;
+
+	/* The hitbox a hit from LineTraceShot went through, null when it hit something else */
+	const FSHitbox* GetHitbox(const FHitResult& Hit) const;
+
+	/* Transform of the pawn at RewindTime, false if it is not compensated */
+	bool GetRewoundTransform(const APawn* Pawn, float RewindTime, FTransform& OutTransform) const;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	// Fixed ring size, 64 frames cover a bit over a second at a 60Hz server tick
+	static const int32 MaxFrames = 64;
+
+	static const int32 MaxPawns = 64;
+
+protected:
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	void RecordFrame();
+
+	/* Finds the recorded frames around Time (ring indices) and the blend between them */
+	bool FindFrames(float Time, int32& OutOlderFrame, int32& OutNewerFrame, float& OutAlpha) const;
+
+	FTransform GetInterpolatedTransform(int32 PawnSlot, int32 OlderFrame, int32 NewerFrame, float Alpha) const;
+
+	/* FindFrames for a shot's rewind time, false when pawns are tested where they are now */
+	bool FindRewindFrames(float RewindTime, int32& OutOlderFrame, int32& OutNewerFrame, float& OutAlpha) const;
+
+	/* Where the pawn in PawnSlot was at the frames found by FindRewindFrames, Current if it was not rewound */
+	FTransform GetPawnTransform(int32 PawnSlot, const FTransform& Current, bool bRewind, int32 OlderFrame, int32 NewerFrame, float Alpha) const;
+
+	/* Traces one pawn placed at Rewound, through its hitboxes or by moving the ray to where its collision is now */
+	bool LineTracePawnSlot(int32 PawnSlot, APawn* Pawn, const FTransform& Current, const FTransform& Rewound, const FVector& Start, const FVector& End, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params, FHitResult& OutHit) const;
+
+	// Registered pawns by slot, null for free slots
+	TWeakObjectPtr<APawn> Pawns[MaxPawns];
+
+	// Bounding sphere radius of each pawn, for rejecting pawns far from the shot
+	float PawnRadii[MaxPawns];
+
+	// Time the pawn was registered, older frames hold no data for its slot
+	float PawnRegisterTimes[MaxPawns];
+
+	// Owned by the pawns, only read while the pawn is alive
+	const TArray<FSHitbox>* PawnHitboxes[MaxPawns];
+
+	const USkeletalMeshComponent* PawnMeshes[MaxPawns];
+
+	int32 NumPawns;
+
+	// Server world time of every frame
+	TArray<float> FrameTimes;
+
+	TArray<FVector> Locations;
+
+	TArray<FQuat> Rotations;
+
+	// Ring index of the next frame to write
+	int32 NextFrame;
+
+	int32 NumFrames;
+
+	bool bRecordHistory;
+};
@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "SReplicationGraph.generated.h"
+
+class UReplicationGraphNode_GridSpatialization2D;
+class UReplicationGraphNode_ActorList;
+
+
+/* Which node a replicated class is routed to */
+enum class ESClassRepNodeMapping : uint32
+{
+	// Not routed to a global node, replicated through a per-connection node or as a dependent actor
+	NotRouted,
+
+	// Replicated to every connection (game state)
+	RelevantAllConnections,
+
+	// Spatialized, never moves
+	Spatialize_Static,
+
+	// Spatialized, location is updated every frame
+	Spatialize_Dynamic,
+
+	// Spatialized, treated as static while dormant and dynamic while awake
+	Spatialize_Dormancy,
+};
+
+
+/**
+ * Replication graph for the horde game, replaces per-connection relevancy checks of every replicated actor with:
+ *  - A spatial grid for pawns, tracker bots, weapons (HitScanBurst) and barrels
+ *  - An always relevant list for the game state
+ *  - A per-connection node for the connection's own controller, player state and pawn
+ *  - A frequency limited node handing out the other player states a few at a time
+ *  - Dormancy aware grid entries for pickups, powerups and barrels
+ *
+ * Enabled through ReplicationDriverClassName in DefaultEngine.ini.
+ */
+UCLASS(Transient, config=Engine)
+class COOPGAME_API USReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+
+	USReplicationGraph();
+
+	virtual void InitGlobalActorClassSettings() override;
+
+	virtual void InitGlobalGraphNodes() override;
+
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+protected:
+
+	/* Sets routing and net rate of a class, ReplicationPeriodFrame 0 derives the rate from the class's NetUpdateFrequency */
+	void SetClassSettings(UClass* Class, ESClassRepNodeMapping Mapping, uint32 ReplicationPeriodFrame, float CullDistance);
+
+	ESClassRepNodeMapping GetMappingPolicy(UClass* Class);
+
+	TClassMap<ESClassRepNodeMapping> ClassRepNodePolicies;
+
+	// Classes configured in SetClassSettings, their children don't fall back to the legacy settings
+	TArray<UClass*> ExplicitlySetClasses;
+};
+
+
+/* The connection's own controller, player state, view target and pawn */
+UCLASS()
+class COOPGAME_API USReplicationGraphNode_AlwaysRelevant_ForConnection : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& Actor) override { }
+
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true) override { return false; }
+
+	virtual void NotifyResetAllNetworkActors() override { }
+
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+protected:
+
+	FActorRepListRefView ReplicationActorList;
+
+	bool bInitializedPlayerState;
+};
+
+
+/* Player states of all players, split in small lists of which one is returned per frame */
+UCLASS()
+class COOPGAME_API USReplicationGraphNode_PlayerStateFrequencyLimiter : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+public:
+
+	USReplicationGraphNode_PlayerStateFrequencyLimiter();
+
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& Actor) override { }
+
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true) override { return false; }
+
+	virtual void NotifyResetAllNetworkActors() override { }
+
+	virtual void PrepareForReplication() override;
+
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+	/* Player states per list, 8 players at 2 per frame means each player state is considered every 4th frame */
+	int32 TargetActorsPerFrame;
+
+protected:
+
+	TArray<FActorRepListRefView> ReplicationActorLists;
+};
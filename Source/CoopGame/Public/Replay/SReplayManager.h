@@ -0,0 +1,190 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SWorldManager.h"
+#include "SReplayTypes.h"
+#include "SReplayManager.generated.h"
+
+class APlayerController;
+class APawn;
+class ASWeapon;
+enum class EWaveState : uint8;
+
+
+/* Bot spawned by the wave director in a recorded frame */
+struct FSReplayBotSpawn
+{
+	FString ClassPath;
+
+	FVector Location;
+
+	FRotator Rotation;
+};
+
+
+/* Single frame read back from a replay stream */
+struct FSReplayFrame
+{
+	float DeltaSeconds;
+
+	TArray<TPair<uint8, FSReplayPlayerInput>> Inputs;
+
+	// Shots of all inputs in input order, every input owns the next NumShots of them
+	TArray<FSReplayShot> Shots;
+
+	// Same for ammo events, every input owns the next NumAmmoEvents
+	TArray<FSReplayAmmoEvent> AmmoEvents;
+
+	TArray<FSReplayBotSpawn> BotSpawns;
+
+	TArray<EWaveState> WaveStates;
+
+	bool bValid;
+
+	FSReplayFrame()
+		: DeltaSeconds(0.0f), bValid(false)
+	{
+	}
+};
+
+
+/**
+ * Records a match on the server (player inputs, every shot with its aim and timing, ammo changes, RNG seed and wave director decisions)
+ * into a compact binary stream, and replays it headless at full speed so the same session can be measured against different builds.
+ * Playback runs on a dedicated server with no clients, the recorded players are driven through controllers without a
+ * local player or connection, the way the server saw them while recording.
+ * Recorded shots are fired again without touching the weapon's own ammo or shot counter. The replay keeps its own ammo count
+ * from the recorded ammo events instead, and reports shots the stream has no ammo for as divergence, like wave states.
+ *
+ * Record:		-ReplayRecord=<file>
+ * Playback:	-server -nullrhi -ReplayPlay=<file>
+ *
+ * Both modes write a frame time histogram next to the replay file (<file>.frametimes.csv) when they stop.
+ */
+UCLASS()
+class COOPGAME_API ASReplayManager : public ASWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	ASReplayManager();
+
+	/* Starts recording or playback when requested on the command line. Called by the game mode before the first wave. */
+	static void StartFromCommandLine(const UObject* WorldContextObject);
+
+	static bool IsRecording(const UObject* WorldContextObject);
+
+	static bool IsPlayingBack(const UObject* WorldContextObject);
+
+	/* Seed for anything random a replay has to reproduce, from the replay's own stream while one runs */
+	static int32 GetRandomSeed(const UObject* WorldContextObject);
+
+	/* Wave director decision, recorded while recording and verified against the stream during playback */
+	void NotifyWaveState(EWaveState NewState);
+
+	/* A shot the server fired for the player controlling Shooter, written with the player's next input */
+	void RecordShot(APawn* Shooter, const FSReplayShot& Shot);
+
+	/* Ammo of the weapon in Owner's hands changed for anything but a traced shot, written with the player's next input */
+	void RecordAmmoEvent(APawn* Owner, ESReplayAmmoEvent Type, float Ammo);
+
+	virtual void Tick(float DeltaSeconds) override;
+
+protected:
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	bool StartRecording(const FString& Filename);
+
+	bool StartPlayback(const FString& Filename);
+
+	void Stop();
+
+	void RecordFrame(float DeltaSeconds);
+
+	void PlaybackFrame();
+
+	bool ReadFrame(FSReplayFrame& OutFrame);
+
+	void OnActorSpawned(AActor* Actor);
+
+	void SpawnRecordedBot(const FSReplayBotSpawn& BotSpawn);
+
+	APlayerController* GetPlaybackController(int32 Slot);
+
+	/* Follows a player's ammo through the frame's ammo events and checks every recorded shot against it and the weapon */
+	void CheckPlaybackShots(uint8 Slot, const ASWeapon* Weapon, const FSReplayPlayerInput& Input, const FSReplayShot* Shots, const FSReplayAmmoEvent* AmmoEvents);
+
+	void AddFrameTime(double FrameTime);
+
+	void WriteFrameTimeHistogram() const;
+
+	enum class EReplayMode : uint8
+	{
+		None,
+
+		Recording,
+
+		Playback,
+	};
+
+	EReplayMode Mode;
+
+	FString ReplayFilename;
+
+	TUniquePtr<FArchive> Archive;
+
+	int32 Seed;
+
+	// Seeded with Seed, so nothing depends on the engine's global random numbers that everything else shares
+	FRandomStream RandomStream;
+
+	int32 FrameNumber;
+
+	// Recording: player controller to stable player slot
+	TMap<TWeakObjectPtr<APlayerController>, uint8> PlayerSlots;
+
+	// Recording: shots fired since the last frame, per player
+	TMap<TWeakObjectPtr<APlayerController>, TArray<FSReplayShot>> PendingShots;
+
+	// Recording: ammo events since the last frame, per player
+	TMap<TWeakObjectPtr<APlayerController>, TArray<FSReplayAmmoEvent>> PendingAmmoEvents;
+
+	// Recording: bot classes already written to the stream
+	TMap<FString, int32> BotClassTable;
+
+	// Playback: bot classes read from the stream
+	TArray<FString> BotClassPaths;
+
+	// Playback: controller of every recorded player slot
+	TArray<TWeakObjectPtr<APlayerController>> PlaybackControllers;
+
+	// Playback: pawns we already hooked up to tick after the replay manager
+	TArray<TWeakObjectPtr<APawn>> PlaybackPawns;
+
+	// Playback: frame applied next tick, read ahead so its delta time can be set as the fixed time step
+	FSReplayFrame NextFrame;
+
+	// Playback: ammo of every recorded player's weapon according to the stream, INDEX_NONE until an event tells
+	TArray<int32> PlaybackAmmo;
+
+	int32 NumPlaybackShots;
+
+	int32 ShotMismatches;
+
+	TArray<EWaveState> ExpectedWaveStates;
+
+	TArray<EWaveState> ObservedWaveStates;
+
+	int32 WaveStateMismatches;
+
+	FDelegateHandle ActorSpawnedHandle;
+
+	// Real time frame histogram in FrameTimeBucketMs buckets
+	TArray<int32> FrameTimeHistogram;
+
+	double LastFrameRealTime;
+};
@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+// File identifier and format version of the server replay stream
+#define SREPLAY_MAGIC				0x4C505243 // 'CRPL'
+#define SREPLAY_VERSION				3
+
+
+// Record tags, every record in the stream starts with one of these
+enum class ESReplayRecord : uint8
+{
+	// Start of a new server frame (delta seconds + player inputs and their shots)
+	Frame,
+
+	// Wave director changed the wave state
+	WaveState,
+
+	// Wave director spawned a bot
+	BotSpawn,
+
+	EndOfStream,
+};
+
+
+enum ESReplayInputFlags : uint8
+{
+	REPLAYINPUT_Crouched	= 1 << 0,
+	REPLAYINPUT_Jumping		= 1 << 1,
+	REPLAYINPUT_Aiming		= 1 << 2,
+	REPLAYINPUT_Moving		= 1 << 3,
+};
+
+
+/* Server side input state of a single player for one frame, quantized to 9 bytes */
+struct FSReplayPlayerInput
+{
+	// World space movement direction, scaled to [-127, 127]
+	int8 MoveX;
+	int8 MoveY;
+
+	// Compressed control rotation
+	uint16 Pitch;
+	uint16 Yaw;
+
+	uint8 Flags;
+
+	// Shots the server fired for this player since the last frame, the input is followed by that many FSReplayShot
+	uint8 NumShots;
+
+	// Ammo changes of the player's weapon since the last frame, written after the shots
+	uint8 NumAmmoEvents;
+
+	FSReplayPlayerInput()
+		: MoveX(0), MoveY(0), Pitch(0), Yaw(0), Flags(0), NumShots(0), NumAmmoEvents(0)
+	{
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FSReplayPlayerInput& Input)
+	{
+		Ar << Input.MoveX << Input.MoveY << Input.Pitch << Input.Yaw << Input.Flags << Input.NumShots << Input.NumAmmoEvents;
+		return Ar;
+	}
+};
+
+
+/* A shot the server fired for a player, everything needed to fire the exact same shot again */
+struct FSReplayShot
+{
+	// Where the server traced the shot from
+	FVector EyeLocation;
+
+	// Spread seed of the weapon that fired it
+	int32 SpreadSeed;
+
+	// Aim rotation compressed with FRotator::CompressAxisToShort
+	uint16 AimPitch;
+	uint16 AimYaw;
+
+	// Shot counter of the weapon (low 16 bits), picks the spread together with the seed
+	uint16 ShotIndex;
+
+	// How long before the server processed it the shot was due, in 1/10 ms
+	uint16 Age;
+
+	uint8 SpreadFlags;
+
+	FSReplayShot()
+		: EyeLocation(FVector::ZeroVector), SpreadSeed(0), AimPitch(0), AimYaw(0), ShotIndex(0), Age(0), SpreadFlags(0)
+	{
+	}
+
+	void SetAge(float Seconds)
+	{
+		Age = (uint16)FMath::Clamp(FMath::RoundToInt(Seconds * 10000.0f), 0, (int32)MAX_uint16);
+	}
+
+	float GetAge() const
+	{
+		return Age / 10000.0f;
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FSReplayShot& Shot)
+	{
+		Ar << Shot.EyeLocation << Shot.SpreadSeed << Shot.AimPitch << Shot.AimYaw << Shot.ShotIndex << Shot.Age << Shot.SpreadFlags;
+		return Ar;
+	}
+};
+
+
+enum class ESReplayAmmoEvent : uint8
+{
+	// The player drew a weapon (or was first seen by the recording), Ammo is what it holds
+	Equip,
+
+	Reload,
+
+	// Refilled on respawn
+	Restock,
+
+	// A shot that cost ammo but was not traced (over the fire budget, too old, or its batch never arrived)
+	Spent,
+};
+
+
+/* Ammo of a player's weapon changing for any other reason than a traced shot */
+struct FSReplayAmmoEvent
+{
+	// Shots of the same player and frame that were fired before this event
+	uint8 NumShotsBefore;
+
+	ESReplayAmmoEvent Type;
+
+	// Weapon ammo after the event
+	uint16 Ammo;
+
+	FSReplayAmmoEvent()
+		: NumShotsBefore(0), Type(ESReplayAmmoEvent::Equip), Ammo(0)
+	{
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FSReplayAmmoEvent& Event)
+	{
+		Ar << Event.NumShotsBefore << (uint8&)Event.Type << Event.Ammo;
+		return Ar;
+	}
+};
@@ -4,12 +4,16 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "SHitbox.h"
 #include "SCharacter.generated.h"
 
 class UCameraComponent;
 class USpringArmComponent;
 class ASWeapon;
 class USHealthComponent;
+class ASPlayerState;
+struct FSReplayPlayerInput;
+struct FSReplayShot;
 
 UCLASS()
 class COOPGAME_API ASCharacter : public ACharacter
@@ -50,6 +54,10 @@ protected:
 
 	void EndReload();
 
+	void NextWeapon();
+
+	void PreviousWeapon();
+
 // ------- COMPONENTS ------- \\
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
@@ -96,6 +104,14 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Movement")
 	float CrouchedMovementSpeed;
 
+	/* Scales walk and sprint speed, the product of all active speed boosts */
+	float MovementSpeedMultiplier;
+
+	// Active speed boosts by their source (a powerup), only compared and never dereferenced
+	TMap<const UObject*, float> SpeedBoosts;
+
+	void UpdateSpeedBoosts();
+
 	UPROPERTY(EditDefaultsOnly, Category = "Player")
 	float ZoomedFOV;
 
@@ -105,6 +121,10 @@ protected:
 	/* Default FOV set during begin play */
 	float DefaultFOV;
 
+	/* Shapes weapon shots are traced against, following the mesh's bones */
+	UPROPERTY(EditDefaultsOnly, Category = "Player")
+	TArray<FSHitbox> Hitboxes;
+
 
 // ------- WEAPON ------- \\
 
@@ -114,6 +134,28 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Player")
 	TSubclassOf<ASWeapon> StarterWeaponClass;
 
+	/* Weapons players carry next to the starter weapon. Spawned once per match into the player's inventory. */
+	UPROPERTY(EditDefaultsOnly, Category = "Player")
+	TArray<TSubclassOf<ASWeapon>> InventoryWeaponClasses;
+
+	/* Server only. Spawns the player's weapons the first time, and hands them to this pawn */
+	void TakeInventory(ASPlayerState* InventoryOwner);
+
+	/* Server only. Makes the inventory weapon at Index the current weapon */
+	void EquipWeapon(int32 Index);
+
+	/* Server only. Gives the weapons back to the player's inventory, where they wait hidden for the player's next pawn */
+	void StowWeapons();
+
+	/* Takes the current weapon off the pawn, it stays with the controller */
+	void HolsterWeapon(ASWeapon* Weapon);
+
+	/* Steps through the inventory by Offset from the current weapon */
+	void CycleWeapon(int32 Offset);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerEquipWeapon(int32 Index);
+
 	UPROPERTY(VisibleDefaultsOnly, Category = "Player")
 	FName WeaponAttachSocketName;
 
@@ -128,6 +170,10 @@ public:
 
 	virtual FVector GetPawnViewLocation() const override;
 
+	virtual void PossessedBy(AController* NewController) override;
+
+	ASWeapon* GetCurrentWeapon() const { return CurrentWeapon; }
+
 // ------- INPUT ------- \\
 
 	UFUNCTION(BlueprintCallable, Category = "Player")
@@ -136,6 +182,22 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Player")
 	void StopFire();
 
+	UFUNCTION(BlueprintCallable, Category = "Player")
+	void SetMovementSpeedMultiplier(float NewMultiplier);
+
+	/* Boosts movement speed until the same source removes it again. Boosts from different sources stack. */
+	void AddSpeedBoost(const UObject* Source, float Multiplier);
+
+	void RemoveSpeedBoost(const UObject* Source);
+
+// ------- REPLAY ------- \\
+
+	/* Captures the server side input state of this frame for the replay stream */
+	void BuildReplayInput(FSReplayPlayerInput& OutInput);
+
+	/* Drives the pawn from a recorded input state during replay playback, Shots points at the input's NumShots recorded shots */
+	void ApplyReplayInput(const FSReplayPlayerInput& Input, const FSReplayShot* Shots);
+
 // ------- VARIABLES ------- \\
 
 //Bool
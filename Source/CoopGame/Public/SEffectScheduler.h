@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SWorldManager.h"
+#include "SEffectScheduler.generated.h"
+
+
+DECLARE_DELEGATE(FSEffectTickDelegate);
+
+
+/* Handle to an effect running on the effect scheduler */
+struct FSEffectHandle
+{
+	FSEffectHandle()
+		: Index(INDEX_NONE), Serial(0)
+	{
+	}
+
+	bool IsValid() const
+	{
+		return Index != INDEX_NONE;
+	}
+
+	void Invalidate()
+	{
+		Index = INDEX_NONE;
+	}
+
+private:
+
+	int32 Index;
+
+	uint32 Serial;
+
+	friend class ASEffectScheduler;
+};
+
+
+/**
+ * Drives all periodic gameplay effects of a world (powerup ticks, self damage, damage over time) from a single timing wheel,
+ * instead of one timer manager entry per effect. The wheel advances in fixed slots and only visits effects that are due.
+ */
+UCLASS()
+class COOPGAME_API ASEffectScheduler : public ASWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	ASEffectScheduler();
+
+	/**
+	 * Call OnTick every Interval seconds.
+	 * @param NumTicks		Amount of ticks before the effect stops by itself, 0 to run until stopped
+	 * @param FirstDelay	Delay before the first tick, negative to wait one interval
+	 */
+	FSEffectHandle StartEffect(const FSEffectTickDelegate& OnTick, float Interval, int32 NumTicks = 0, float FirstDelay = -1.0f);
+
+	/* Stops the effect (safe to call from inside its own tick) and invalidates the handle */
+	void StopEffect(FSEffectHandle& Handle);
+
+	bool IsEffectActive(const FSEffectHandle& Handle) const;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	// Amount of slots in the wheel, effects further out than one revolution wait for their round
+	static const int32 NumSlots = 256;
+
+protected:
+
+	struct FEffect
+	{
+		FSEffectTickDelegate OnTick;
+
+		// Wheel tick at which the effect fires next
+		uint64 NextTick;
+
+		uint32 IntervalTicks;
+
+		// INDEX_NONE when running until stopped
+		int32 RemainingTicks;
+
+		uint32 Serial;
+
+		bool bActive;
+	};
+
+	void ProcessSlot(int32 SlotIndex);
+
+	int32 SecondsToTicks(float Seconds) const;
+
+	TSparseArray<FEffect> Effects;
+
+	// Effect indices per slot
+	TArray<int32> Slots[NumSlots];
+
+	TArray<int32> SlotBeingProcessed;
+
+	uint64 CurrentTick;
+
+	float TimeAccumulator;
+
+	// Duration of a single slot in seconds
+	float SlotDuration;
+
+	uint32 NextSerial;
+};
@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SWorldManager.h"
+#include "SFXBudget.generated.h"
+
+class UParticleSystem;
+class UParticleSystemComponent;
+class USceneComponent;
+
+
+UENUM()
+enum class ESFXCategory : uint8
+{
+	Muzzle,
+
+	Tracer,
+
+	Impact,
+
+	Explosion,
+
+	MAX UMETA(Hidden)
+};
+
+
+/**
+ * Decides which cosmetic effects actually play on this machine. Effect requests of a frame are collected, ranked by
+ * significance (type, distance to the local camera, on or off screen) and played through the FX pool from the most
+ * significant down, until the category's limit of playing emitters is reached. Far effects play at their lowest detail
+ * level and the rest is dropped.
+ *
+ * Nothing here depends on rendering, so the counters are the same in -nullrhi sessions (see COOP.FXBudget.Stats).
+ */
+UCLASS()
+class COOPGAME_API ASFXBudget : public ASWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	ASFXBudget();
+
+	/* Queues an effect at a location. ParameterName, when set, is given ParameterValue as a vector parameter (tracer targets) */
+	static void RequestEmitterAtLocation(const UObject* WorldContextObject, UParticleSystem* Template, ESFXCategory Category, const FVector& Location,
+		const FRotator& Rotation = FRotator::ZeroRotator, FName ParameterName = NAME_None, const FVector& ParameterValue = FVector::ZeroVector);
+
+	/* Queues an effect snapped to a socket of AttachToComponent */
+	static void RequestEmitterAttached(UParticleSystem* Template, ESFXCategory Category, USceneComponent* AttachToComponent, FName AttachPointName = NAME_None);
+
+	/* Significance of an effect seen from a camera, higher plays first, 0 is never played */
+	static float GetSignificance(ESFXCategory Category, const FVector& Location, const FVector& ViewLocation, const FVector& ViewDirection, float ViewHalfFOV);
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	// Requests past this in a single frame are dropped as soon as they come in
+	static const int32 MaxPendingRequests = 256;
+
+	// Totals since the last reset, per category
+	int32 NumRequested[(int32)ESFXCategory::MAX];
+
+	int32 NumPlayed[(int32)ESFXCategory::MAX];
+
+	int32 NumDowngraded[(int32)ESFXCategory::MAX];
+
+	int32 NumDropped[(int32)ESFXCategory::MAX];
+
+	void ResetCounters();
+
+protected:
+
+	struct FRequest
+	{
+		TWeakObjectPtr<UParticleSystem> Template;
+
+		TWeakObjectPtr<USceneComponent> AttachToComponent;
+
+		FName AttachPointName;
+
+		FVector Location;
+
+		FRotator Rotation;
+
+		FName ParameterName;
+
+		FVector ParameterValue;
+
+		float Significance;
+
+		ESFXCategory Category;
+
+		bool bAttached;
+	};
+
+	struct FPlayingEmitter
+	{
+		TWeakObjectPtr<UParticleSystemComponent> Component;
+
+		ESFXCategory Category;
+	};
+
+	void AddRequest(FRequest& Request);
+
+	/* Plays the queued requests of this frame */
+	void ProcessRequests();
+
+	/* Plays a request right away, at the lowest detail level if bDowngrade */
+	void PlayRequest(const FRequest& Request, bool bDowngrade);
+
+	/* Camera of the local player, false on machines without one */
+	bool GetView(FVector& OutLocation, FVector& OutDirection, float& OutHalfFOV) const;
+
+	TArray<FRequest> PendingRequests;
+
+	// Emitters started by the budget that may still be playing
+	TArray<FPlayingEmitter> PlayingEmitters;
+};
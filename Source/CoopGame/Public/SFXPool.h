@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SWorldManager.h"
+#include "SFXPool.generated.h"
+
+class UParticleSystem;
+class UParticleSystemComponent;
+class USceneComponent;
+
+
+/* Idle components of one particle system */
+USTRUCT()
+struct FSFXPoolList
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<UParticleSystemComponent*> Free;
+
+	// Free and playing
+	int32 NumComponents;
+
+	FSFXPoolList()
+		: NumComponents(0)
+	{
+	}
+};
+
+
+/**
+ * Reuses particle system components for short one-shot effects (muzzle flashes, tracers, impacts, explosions)
+ * instead of spawning and destroying a component for every shot. Components are owned by the pool, play at a location
+ * or attached to a socket, and come back to the pool by themselves when the system finishes.
+ */
+UCLASS()
+class COOPGAME_API ASFXPool : public ASWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Same as UGameplayStatics::SpawnEmitterAtLocation, through the world's pool */
+	static UParticleSystemComponent* SpawnEmitterAtLocation(const UObject* WorldContextObject, UParticleSystem* Template, const FVector& Location, const FRotator& Rotation = FRotator::ZeroRotator);
+
+	/* Same as UGameplayStatics::SpawnEmitterAttached (snapped to the socket), through the world's pool */
+	static UParticleSystemComponent* SpawnEmitterAttached(UParticleSystem* Template, USceneComponent* AttachToComponent, FName AttachPointName = NAME_None);
+
+	/* Makes sure at least Count components of Template exist, so the first effects don't allocate */
+	static void Prewarm(const UObject* WorldContextObject, UParticleSystem* Template, int32 Count);
+
+	/* False on dedicated servers (always in server builds), nobody sees effects there so no components are ever made */
+	static bool CanPlayEffects(const UObject* WorldContextObject);
+
+	/* Idle component for Template, null if the pool for it is full */
+	UParticleSystemComponent* Acquire(UParticleSystem* Template);
+
+protected:
+
+	UParticleSystemComponent* CreateComponent(UParticleSystem* Template);
+
+	UFUNCTION()
+	void OnSystemFinished(UParticleSystemComponent* PSystem);
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY()
+	TMap<UParticleSystem*, FSFXPoolList> Pools;
+};
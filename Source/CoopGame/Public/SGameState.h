@@ -34,6 +34,9 @@ class COOPGAME_API ASGameState : public AGameStateBase
 
 protected:
 
+	// Starts the load test bot or reporter when requested on the command line
+	virtual void BeginPlay() override;
+
 	UFUNCTION()
 	void OnRep_WaveState(EWaveState OldState);
 
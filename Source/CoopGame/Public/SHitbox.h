@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "SHitbox.generated.h"
+
+class USkeletalMeshComponent;
+
+
+UENUM()
+enum class ESHitboxShape : uint8
+{
+	// Along the local Z axis, a sphere when HalfHeight equals Radius
+	Capsule,
+
+	Box,
+};
+
+
+/* A simple shape weapon shots are traced against analytically instead of the pawn's collision or render mesh */
+USTRUCT()
+struct FSHitbox
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	FName Region;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	ESHitboxShape Shape;
+
+	// Bone the hitbox follows, None to stay relative to the actor
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	FName BoneName;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	FVector Offset;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	FRotator Rotation;
+
+	// Capsules only
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	float Radius;
+
+	// Capsules only, including the rounded ends
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	float HalfHeight;
+
+	// Boxes only
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	FVector BoxExtent;
+
+	// Applied to the weapon's base damage
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	float DamageMultiplier;
+
+	// Surface used for impact effects
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	TEnumAsByte<EPhysicalSurface> SurfaceType;
+
+	FSHitbox();
+
+	static FSHitbox MakeCapsule(FName InRegion, FName InBoneName, float InRadius, float InHalfHeight, float InDamageMultiplier, EPhysicalSurface InSurfaceType,
+		const FVector& InOffset = FVector::ZeroVector, const FRotator& InRotation = FRotator::ZeroRotator);
+
+	static FSHitbox MakeBox(FName InRegion, FName InBoneName, const FVector& InBoxExtent, float InDamageMultiplier, EPhysicalSurface InSurfaceType);
+
+	/* Distance along the normalized Direction at which the ray enters the hitbox, placed at HitboxToWorld */
+	bool Raycast(const FTransform& HitboxToWorld, const FVector& Start, const FVector& Direction, float MaxDistance, float& OutDistance, FVector& OutNormal) const;
+
+	/**
+	 * Traces a pawn's hitboxes, with the actor at ActorTransform (which may be rewound) and bones posed as Mesh is right now.
+	 * Fills in OutHit with Item set to the index of the hitbox that was hit.
+	 */
+	static bool LineTraceHitboxes(const TArray<FSHitbox>& Hitboxes, AActor* Actor, const FTransform& ActorTransform, const USkeletalMeshComponent* Mesh, const FVector& Start, const FVector& End, FHitResult& OutHit);
+};
@@ -32,18 +32,35 @@ protected:
 	UPROPERTY(EditInstanceOnly, Category = "PickupActor")
 	TSubclassOf<ASPowerupActor> PowerUpClass;
 
+	/* Pooled powerup, spawned once and reused every time the pickup comes off cooldown */
+	UPROPERTY(ReplicatedUsing=OnRep_PowerupAvailable)
 	ASPowerupActor* PowerUpInstance;
 
+	/* Available or cooling down, the only state that changes during the match */
+	UPROPERTY(ReplicatedUsing=OnRep_PowerupAvailable)
+	bool bPowerupAvailable;
+
+	UFUNCTION()
+	void OnRep_PowerupAvailable();
+
 	UPROPERTY(EditInstanceOnly, Category = "PickupActor")
 	float CooldownDuration;
 
 	FTimerHandle TimerHandle_RespawnTimer;
 
+	// Cooldown ended while the pooled powerup was still applying its effect
+	bool bRespawnWhenExpired;
+
 	void Respawn();
 
+	void SpawnPowerupInstance();
+
 public:	
 
 	virtual void NotifyActorBeginOverlap(AActor* OtherActor) override;
 
+	/* Called by the pooled powerup when its effect ran out */
+	void OnPowerupExpired(ASPowerupActor* Powerup);
+
 	
 };
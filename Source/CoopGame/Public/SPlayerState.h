@@ -6,6 +6,8 @@
 #include "GameFramework/PlayerState.h"
 #include "SPlayerState.generated.h"
 
+class ASWeapon;
+
 /**
  * 
  */
@@ -16,8 +18,55 @@ class COOPGAME_API ASPlayerState : public APlayerState
 	
 public:
 
+	ASPlayerState();
+
 	UFUNCTION(BlueprintCallable, Category = "PlayerState")
 	void AddScore(float ScoreDelta);
-	
-	
+
+	/**
+	 * Server only. Takes one shot from this player's fire budget, a token bucket refilled at ShotsPerSecond.
+	 * Returns false if the player is over budget (or flagged for flooding) and the shot must not be traced.
+	 */
+	bool ConsumeShotToken(float ShotsPerSecond);
+
+	/* True while this player has been over the fire budget too often, all of their shots are dropped */
+	bool IsShotFloodFlagged() const { return bShotFloodFlagged; }
+
+	/* Server only. Adds a weapon to the inventory, it belongs to this player for the rest of the match */
+	void AddWeapon(ASWeapon* Weapon);
+
+	/* The player's weapons, on servers and the owning client */
+	const TArray<ASWeapon*>& GetWeapons() const { return Weapons; }
+
+	ASWeapon* GetWeapon(int32 Index) const;
+
+	/* Server only. Index of the weapon the player had equipped last, their next pawn starts with it */
+	int32 GetCurrentWeaponIndex() const { return CurrentWeaponIndex; }
+
+	void SetCurrentWeaponIndex(int32 Index);
+
+protected:
+
+	/* The weapons go with the player */
+	virtual void Destroyed() override;
+
+// ------- INVENTORY ------- \\
+
+	// Spawned once per match, pawns only borrow them. Replicated to the owner only.
+	UPROPERTY(Replicated)
+	TArray<ASWeapon*> Weapons;
+
+	int32 CurrentWeaponIndex;
+
+// ------- FIRE BUDGET ------- \\
+
+	// Shots the player may fire right now
+	float ShotTokens;
+
+	float LastShotTokenTime;
+
+	// One strike per dropped shot, decays over time
+	float ShotFloodStrikes;
+
+	bool bShotFloodFlagged;
 };
@@ -4,8 +4,26 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "SEffectScheduler.h"
 #include "SPowerupActor.generated.h"
 
+class ASCharacter;
+
+
+UENUM(BlueprintType)
+enum class EPowerupEffect : uint8
+{
+	// Implemented in Blueprint through OnPowerupTicked
+	Custom,
+
+	// Heals EffectMagnitude every tick
+	HealOverTime,
+
+	// Multiplies movement speed by EffectMagnitude while active
+	SpeedBoost,
+};
+
+
 UCLASS()
 class COOPGAME_API ASPowerupActor : public AActor
 {
@@ -25,7 +43,22 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Powerups")
 	int32 TotalNrOfTicks;
 
-	FTimerHandle TimerHandle_PowerupTick;
+	/* Native effect applied by the powerup, Custom calls OnPowerupTicked instead */
+	UPROPERTY(EditDefaultsOnly, Category = "Powerups")
+	EPowerupEffect EffectType;
+
+	/* Heal amount per tick or speed multiplier, depending on EffectType */
+	UPROPERTY(EditDefaultsOnly, Category = "Powerups")
+	float EffectMagnitude;
+
+	FSEffectHandle PowerupTickEffect;
+
+	// Actor the powerup was activated for
+	UPROPERTY(Replicated)
+	AActor* ActiveForActor;
+
+	// Character our speed boost is applied to, on server and clients
+	TWeakObjectPtr<ASCharacter> BoostedCharacter;
 
 	// Total number of ticks applied
 	int32 TicksProcessed;
@@ -47,6 +80,14 @@ public:
 
 	void ActivatePowerup(AActor* ActiveFor);
 
+	/* Stops a running effect and clears all activation state so the instance can be handed out again */
+	void ResetPowerup();
+
+	/* Shows or hides the powerup and its pickup collision, called on server and clients by the owning pickup */
+	void SetPowerupVisible(bool bVisible);
+
+	bool IsPowerupActive() const { return bIsPowerupActive; }
+
 	UFUNCTION(BlueprintImplementableEvent, Category = "Powerups")
 	void OnActivated(AActor* ActiveFor);
 
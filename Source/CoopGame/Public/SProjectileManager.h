@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SWorldManager.h"
+#include "SProjectileManager.generated.h"
+
+class ASProjectileWeapon;
+class ASLagCompensation;
+class UParticleSystemComponent;
+
+
+/**
+ * Simulates every projectile of the world without an actor per projectile. Projectiles are rows in a set of parallel arrays
+ * (one array per field), so the flight of all of them (gravity and drag) is a few tight loops over plain floats. Each tick
+ * then sweeps every projectile along the segment it moved in one pass of line traces.
+ *
+ * On the server projectiles do damage through their weapon class and report their impact to the weapon, which replicates it.
+ * Clients fly their own copies for the visuals, which only vanish locally and wait for the server's impact to show it.
+ */
+UCLASS()
+class COOPGAME_API ASProjectileManager : public ASWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	ASProjectileManager();
+
+	/* Launches a projectile of Weapon's class, identified by the weapon and the shot index that fired it */
+	void SpawnProjectile(ASProjectileWeapon* Weapon, uint16 ShotIndex, const FVector& Location, const FVector& Direction, bool bAuthoritative);
+
+	/* Removes the local copy of a projectile the server reported the impact of */
+	void RemoveProjectile(const ASProjectileWeapon* Weapon, uint16 ShotIndex);
+
+	int32 GetNumProjectiles() const { return Ages.Num(); }
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	static const int32 MaxProjectiles = 1024;
+
+protected:
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/* Index of the weapon class in Types, added on first use */
+	int32 GetTypeIndex(const ASProjectileWeapon* Weapon);
+
+	/* Gravity and drag for all projectiles, writes the new positions to Next* */
+	void Integrate(float DeltaSeconds);
+
+	/* Sweeps a projectile from its position to its next one, true if it hit something or expired */
+	bool Sweep(int32 Index, ASLagCompensation* LagCompensation, FHitResult& OutHit, bool& bOutExpired) const;
+
+	void Impact(int32 Index, const FHitResult& Hit);
+
+	/* Swaps the last projectile into Index */
+	void RemoveAt(int32 Index);
+
+	// Weapon class defaults, the projectile params and damage of every projectile type
+	UPROPERTY()
+	TArray<ASProjectileWeapon*> Types;
+
+	// One entry per projectile in every array below
+
+	TArray<float> PositionsX;
+	TArray<float> PositionsY;
+	TArray<float> PositionsZ;
+
+	TArray<float> VelocitiesX;
+	TArray<float> VelocitiesY;
+	TArray<float> VelocitiesZ;
+
+	// Positions at the end of the current tick, before collision
+	TArray<float> NextX;
+	TArray<float> NextY;
+	TArray<float> NextZ;
+
+	// Gravity times the type's gravity scale
+	TArray<float> GravitiesZ;
+
+	TArray<float> Drags;
+
+	TArray<float> Ages;
+
+	TArray<float> Lifetimes;
+
+	TArray<uint16> ShotIndices;
+
+	TArray<uint8> TypeIndices;
+
+	// Only the server's projectiles do damage and report impacts
+	TArray<bool> Authoritative;
+
+	TArray<TWeakObjectPtr<ASProjectileWeapon>> Weapons;
+
+	TArray<TWeakObjectPtr<AActor>> Instigators;
+
+	TArray<TWeakObjectPtr<AController>> InstigatorControllers;
+
+	// Null on dedicated servers
+	TArray<TWeakObjectPtr<UParticleSystemComponent>> Visuals;
+};
@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SWeapon.h"
+#include "Engine/NetSerialization.h"
+#include "SProjectileWeapon.generated.h"
+
+
+// Flight of the projectiles a projectile weapon fires
+USTRUCT()
+struct FSProjectileParams
+{
+	GENERATED_BODY()
+
+public:
+
+	// Speed at the muzzle in cm/s
+	UPROPERTY(EditDefaultsOnly, Category = "Projectile", meta = (ClampMin = 1.0f))
+	float InitialSpeed;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Projectile")
+	float GravityScale;
+
+	// Fraction of its velocity a projectile loses per second
+	UPROPERTY(EditDefaultsOnly, Category = "Projectile", meta = (ClampMin = 0.0f, ClampMax = 1.0f))
+	float Drag;
+
+	// Seconds until the projectile explodes (with an explosion radius) or vanishes
+	UPROPERTY(EditDefaultsOnly, Category = "Projectile", meta = (ClampMin = 0.1f))
+	float Lifetime;
+
+	// Radial damage around the impact, 0 for point damage to whatever was hit
+	UPROPERTY(EditDefaultsOnly, Category = "Projectile", meta = (ClampMin = 0.0f))
+	float ExplosionRadius;
+
+	// Looping effect that follows the projectile
+	UPROPERTY(EditDefaultsOnly, Category = "Projectile")
+	UParticleSystem* ProjectileEffect;
+
+	FSProjectileParams()
+		: InitialSpeed(3000.0f), GravityScale(1.0f), Drag(0.0f), Lifetime(5.0f), ExplosionRadius(0.0f), ProjectileEffect(nullptr)
+	{
+	}
+};
+
+
+// Where a projectile ended, sent to everyone so they stop their copy of it there
+USTRUCT()
+struct FSProjectileImpact
+{
+	GENERATED_BODY()
+
+public:
+
+	// Shot counter of the shot that fired the projectile (low 16 bits)
+	UPROPERTY()
+	uint16 ShotIndex;
+
+	UPROPERTY()
+	uint8 SurfaceType;
+
+	UPROPERTY()
+	FVector_NetQuantize Location;
+};
+
+
+// The most recent projectile impacts of a weapon, a ring buffer like FSHitScanBurst
+USTRUCT()
+struct FSProjectileImpactBurst
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	FSProjectileImpact Impacts[8];
+
+	UPROPERTY()
+	uint8 ImpactCounter;
+};
+
+
+/**
+ * Fires projectiles instead of hitscan shots. Projectiles are not actors, they are simulated by the world's projectile manager.
+ * Shots are fired, batched and replicated like hitscan shots (so remote clients spawn their own copy from the shooter's aim),
+ * only the impacts are replicated on top.
+ */
+UCLASS()
+class COOPGAME_API ASProjectileWeapon : public ASWeapon
+{
+	GENERATED_BODY()
+
+public:
+
+	ASProjectileWeapon();
+
+	const FSProjectileParams& GetProjectileParams() const { return ProjectileParams; }
+
+	/* Damage of a projectile from this weapon class, called on the class default object by the projectile manager */
+	void ApplyProjectileDamage(const UObject* WorldContextObject, const FHitResult& Hit, const FVector& Direction, AActor* DamageCauser, AController* InstigatorController) const;
+
+	/* Server only, a projectile fired by this weapon hit something (or expired) */
+	void OnProjectileImpact(uint16 ShotIndex, const FVector& Location, EPhysicalSurface SurfaceType);
+
+protected:
+
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
+	FSProjectileParams ProjectileParams;
+
+	UPROPERTY(ReplicatedUsing=OnRep_ProjectileImpacts)
+	FSProjectileImpactBurst ProjectileImpacts;
+
+	// Clients only, impact counter of the last impact played
+	uint8 LastPlayedImpactCounter;
+
+	UFUNCTION()
+	void OnRep_ProjectileImpacts();
+
+	virtual void ProcessShot(const FVector& EyeLocation, FHitScanTrace& Shot, float RewindTime) override;
+
+	virtual void PlayHitScanTrace(const FVector& EyeLocation, const FHitScanTrace& Shot) override;
+
+	/* Launches the projectile of a shot, only the server's projectiles do damage */
+	void LaunchProjectile(const FVector& EyeLocation, const FHitScanTrace& Shot);
+
+};
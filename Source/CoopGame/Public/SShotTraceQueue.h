@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SWorldManager.h"
+#include "SWeapon.h"
+#include "SShotTraceQueue.generated.h"
+
+
+/**
+ * Server side, traces the hitscan shots of a frame asynchronously (COOP.AsyncShotTraces). The world part of every shot is
+ * submitted as an async line trace that runs alongside the rest of the frame. Pawns are tested right away, since their
+ * hitboxes are plain math and may need rewinding. At the start of the next frame all shots are resolved in one batch, in
+ * the order they were fired, which applies their damage and adds them to the weapons' replicated bursts.
+ */
+UCLASS()
+class COOPGAME_API ASShotTraceQueue : public ASWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	ASShotTraceQueue();
+
+	/* Is async shot tracing enabled (COOP.AsyncShotTraces) */
+	static bool IsEnabled();
+
+	/* Queues a shot of Weapon from Start along the normalized Direction, pawns are rewound to RewindTime if it is not negative */
+	void QueueShot(ASWeapon* Weapon, const FVector& Start, const FVector& Direction, float Range, const FCollisionQueryParams& Params, float RewindTime, const FHitScanTrace& Shot);
+
+	/* Resolves the shots of earlier frames */
+	void ResolveShots();
+
+	virtual void Tick(float DeltaSeconds) override;
+
+protected:
+
+	struct FQueuedShot
+	{
+		TWeakObjectPtr<ASWeapon> Weapon;
+
+		FHitScanTrace Shot;
+
+		FVector Start;
+
+		FVector End;
+
+		FVector Direction;
+
+		FCollisionQueryParams Params;
+
+		// Closest pawn hit, only valid if bPawnHit
+		FHitResult PawnHit;
+
+		FTraceHandle WorldTrace;
+
+		uint64 Frame;
+
+		bool bPawnHit;
+	};
+
+	// In the order the shots were fired
+	TArray<FQueuedShot> QueuedShots;
+};
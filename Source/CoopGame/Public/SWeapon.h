@@ -4,13 +4,27 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "SWeaponFireModes.h"
 #include "SWeapon.generated.h"
 
 class USkeletalMeshComponent;
 class UDamageType;
 class UParticleSystem;
+class ASShotTraceQueue;
+struct FSReplayShot;
+enum class ESReplayAmmoEvent : uint8;
 
-// Contains information of a single hitscan weapon linetrace
+enum ESShotSpreadFlags : uint8
+{
+	SHOTSPREAD_Aiming	= 1 << 0,
+	SHOTSPREAD_Crouched	= 1 << 1,
+	SHOTSPREAD_Moving	= 1 << 2,
+
+	SHOTSPREAD_Mask		= 0x07,
+};
+
+
+// Contains information of a single hitscan weapon shot, remote clients rebuild its direction from the weapon's spread seed
 USTRUCT()
 struct FHitScanTrace
 {
@@ -18,11 +32,82 @@ struct FHitScanTrace
 
 public:
 
+	// Aim rotation compressed with FRotator::CompressAxisToShort
+	UPROPERTY()
+	uint16 AimPitch;
+
+	UPROPERTY()
+	uint16 AimYaw;
+
+	// Shot counter of the shot (low 16 bits), picks its spread
+	UPROPERTY()
+	uint16 ShotIndex;
+
+	// Distance from the shooter's eyes to the impact, quantized over the weapon range. MAX_uint16 when nothing was hit.
+	UPROPERTY()
+	uint16 HitDistance;
+
+	// Spread flags in the low 3 bits, surface type of the impact in the high 5 bits
+	UPROPERTY()
+	uint8 SpreadAndSurface;
+
+	uint8 GetSpreadFlags() const
+	{
+		return SpreadAndSurface & SHOTSPREAD_Mask;
+	}
+
+	EPhysicalSurface GetSurfaceType() const
+	{
+		return (EPhysicalSurface)(SpreadAndSurface >> 3);
+	}
+
+	void SetSpreadAndSurface(uint8 SpreadFlags, EPhysicalSurface SurfaceType)
+	{
+		SpreadAndSurface = (SpreadFlags & SHOTSPREAD_Mask) | ((FMath::Min<uint8>(SurfaceType, 31)) << 3);
+	}
+};
+
+
+// The most recent shots of a weapon in a ring buffer. Only slots that changed are sent, so a burst of shots
+// between two net updates costs one slot each, and remote clients play every shot past the last counter they saw.
+USTRUCT()
+struct FSHitScanBurst
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	FHitScanTrace Shots[8];
+
+	// Number of shots written so far (wraps around), the next one goes into Shots[BurstCounter % 8]
+	UPROPERTY()
+	uint8 BurstCounter;
+};
+
+
+// A single shot fired by a client, sent to the server in batches
+USTRUCT()
+struct FSShotRecord
+{
+	GENERATED_BODY()
+
+public:
+
+	// Server world time the client fired at
+	UPROPERTY()
+	float Timestamp;
+
+	// Aim rotation compressed with FRotator::CompressAxisToShort
+	UPROPERTY()
+	uint16 AimPitch;
+
 	UPROPERTY()
-	TEnumAsByte<EPhysicalSurface> SurfaceType;
+	uint16 AimYaw;
 
+	// Aiming, crouched and moving flags the spread cone was picked with
 	UPROPERTY()
-	FVector_NetQuantize TraceTo;
+	uint8 SpreadFlags;
 };
 
 
@@ -35,10 +120,20 @@ public:
 	// Sets default values for this actor's properties
 	ASWeapon();
 
+	/* Applies a shot that went through the shot trace queue: damage, impact and fire effects, and replication */
+	void ResolveQueuedShot(const FVector& EyeLocation, const FVector& ShotDirection, bool bHit, FHitResult& Hit, FHitScanTrace& Shot);
+
+	/* Fires one shot from the given eye point as of ShotTime (world time, now or earlier in the frame). Used by the weapon fire manager. */
+	void FireAt(const FVector& EyeLocation, const FRotator& EyeRotation, float ShotTime);
+
+	float GetTimeBetweenShots() const { return TimeBetweenShots; }
+
 protected:
 
 	virtual void BeginPlay() override;
 
+	virtual void Tick(float DeltaSeconds) override;
+
 // ------- COMPONENTS ------- \\
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components")
@@ -48,15 +143,122 @@ protected:
 
 	void PlayFireEffects(FVector TraceEnd);
 
+	/* Tracer only, for every pellet of a shot after the first */
+	void PlayTracerEffect(FVector TraceEnd);
+
 	void PlayImpactEffects(EPhysicalSurface SurfaceType, FVector ImpactPoint);
 
 	void Fire();
 
+	/**
+	 * Fires a shot that was already paid for, locally predicted or on the server: traces it (or queues the trace),
+	 * plays its effects and on the server adds it to the replicated burst. Weapons that fire something else override this.
+	 */
+	virtual void ProcessShot(const FVector& EyeLocation, FHitScanTrace& Shot, float RewindTime);
+
+	/* ProcessShot specialized for a fire mode policy */
+	template <typename FireModeType>
+	void ProcessShotFor(const FVector& EyeLocation, FHitScanTrace& Shot, float RewindTime);
+
+	/**
+	 * Traces all pellets of a shot in one query and plays their effects. With bApplyDamage the damage of all pellets that hit
+	 * the same actor is applied as one event. Fills in the hit distance and surface of the closest pellet.
+	 */
+	void FirePellets(const FVector& EyeLocation, FHitScanTrace& Shot, float RewindTime, bool bApplyDamage);
+
+	/* Ends of the pellets of a shot and what each of them hit */
+	void TracePellets(const FVector& EyeLocation, const FHitScanTrace& Shot, float RewindTime, TArray<FVector>& OutEnds, TArray<FHitResult>& OutHits) const;
+
+	/* Directions of every pellet of a shot, spread around the shot's own direction */
+	void GetPelletDirections(const FRotator& AimRotation, uint32 ShotIndex, uint8 SpreadFlags, TArray<FVector>& OutDirections) const;
+
+	/* Damage of a blocking hit and the surface its impact effects play for */
+	float GetHitDamage(const FHitResult& Hit, EPhysicalSurface& OutSurfaceType) const;
+
+	/* Traces the shot described by the aim, index and spread of Shot, applies its damage and plays its impact effects.
+	 * Fills in the shot's hit distance and surface, returns the tracer end point. */
+	FVector FireShot(const FVector& EyeLocation, FHitScanTrace& Shot, float RewindTime = -1.0f);
+
+	/* Server only, FireShot through the shot trace queue. The shot is resolved in ResolveQueuedShot next frame. */
+	void QueueShot(ASShotTraceQueue* TraceQueue, const FVector& EyeLocation, const FHitScanTrace& Shot, float RewindTime);
+
+	/* Damage, impact effects, hit distance and surface of a traced shot. Returns the tracer end point. */
+	FVector ProcessShotHit(const FVector& EyeLocation, const FVector& ShotDirection, bool bHit, const FHitResult& Hit, FHitScanTrace& Shot);
+
+	/* Direction of a shot after spread. The same on every machine for the same aim, shot index and flags. */
+	FVector GetShotDirection(const FRotator& AimRotation, uint32 ShotIndex, uint8 SpreadFlags) const;
+
+	/**
+	 * Line trace of a single shot against simple collision and pawn hitboxes, returns true on a blocking hit.
+	 * Pawns are rewound to RewindTime (server world time) if it is not negative.
+	 */
+	bool TraceShot(const FVector& EyeLocation, const FVector& ShotDirection, FHitResult& OutHit, float RewindTime = -1.0f) const;
+
+	/* Simple collision, ignoring the weapon and its owner */
+	FCollisionQueryParams GetShotQueryParams() const;
+
+	/* On machines that show impacts, moves a simple collision hit on the world to the exact polygon it hit */
+	void RefineImpactSurface(const FVector& EyeLocation, const FVector& ShotDirection, FHitResult& InOutHit) const;
+
+	/* Spread cone half angle in radians for the given spread flags */
+	float GetSpreadHalfAngle(uint8 SpreadFlags) const;
+
+	uint8 GetSpreadFlags() const;
+
+	/* Server world time, as far as this machine knows it */
+	float GetServerTime() const;
+
+	/* Sends the shots fired since the last batch to the server */
+	void FlushPendingShots();
+
+	/* Sends NumShots unacknowledged shots, starting at the given index into UnackedShots */
+	void SendShots(int32 FirstUnackedShot, int32 NumShots);
+
+	/**
+	 * All shots a client fired since its last batch, or a resend of shots the server has not acknowledged yet.
+	 * bFromFirstUnacked is set when the client holds no older shot, so shots missing before this batch were given up on.
+	 */
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void ServerFireBatch(const TArray<FSShotRecord>& Shots, uint32 FirstShotIndex, bool bFromFirstUnacked);
+
+	/* Tells the server how many shots the client fired in total and the ammo it predicted, so both stay in sync when batches were dropped */
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerFire();
+	void ServerStopFire(uint32 ClientShotCounter, float ClientAmmo);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerReloadWeapon(uint32 ClientShotCounter, uint8 ClientReloadCounter);
+
+	/* Server only, writes off shots the client fired that never arrived */
+	void ReconcileShots(uint32 ClientShotCounter);
+
+	/* Server ammo after ShotIndex shots, sent only when the server disagrees with the client's prediction */
+	UFUNCTION(Client, Reliable)
+	void ClientCorrectAmmo(uint32 ShotIndex, uint8 ServerReloadCounter, float ServerAmmo);
+
+	/* The server restocked the weapon, shots fired before are paid from the old clip */
+	UFUNCTION(Client, Reliable)
+	void ClientRestock(uint8 ServerReloadCounter, float ServerAmmo);
 
 	UFUNCTION()
-	void OnRep_HitScanTrace();
+	void OnRep_AckedShotIndex();
+
+	/* Server only, hands a shot to the replay manager while a replay is recorded */
+	void RecordReplayShot(const FVector& EyeLocation, const FHitScanTrace& Shot, float ShotAge);
+
+	/* Server only, tells the replay manager the ammo changed, for the weapon in the owner's hands only */
+	void RecordReplayAmmo(ESReplayAmmoEvent Type);
+
+	/* Server only, adds a traced shot to the replicated burst */
+	void AddHitScanTrace(const FHitScanTrace& Shot);
+
+	/* Plays tracer and impact FX of a shot fired by someone else */
+	virtual void PlayHitScanTrace(const FVector& EyeLocation, const FHitScanTrace& Shot);
+
+	template <typename FireModeType>
+	void PlayHitScanTraceFor(const FVector& EyeLocation, const FHitScanTrace& Shot);
+
+	UFUNCTION()
+	void OnRep_HitScanBurst();
 
 // ------- VARIABLES ------- \\
 
@@ -87,6 +289,10 @@ protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
 	UParticleSystem* TracerEffect;
 
+	/* Components of each effect created up front in the world's FX pool */
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon", meta = (ClampMin = 0))
+	int32 PooledEffectCount;
+
 //Camera Shake
 
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
@@ -104,6 +310,21 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
 	float RateOfFire;
 
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
+	ESFireMode FireMode;
+
+	/* Shots per trigger pull in burst mode */
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon", meta = (ClampMin = 1))
+	int32 BurstCount;
+
+	/* Pellets per shot in shotgun mode, BaseDamage is per pellet */
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon", meta = (ClampMin = 1, ClampMax = 32))
+	int32 PelletCount;
+
+	/* Pellet Spread in Degrees, around the direction of the shot */
+	UPROPERTY(EditDefaultsOnly, Category = "Weapon", meta = (ClampMin = 0.0f))
+	float PelletSpread;
+
 	/* Bullet Spread in Degrees */
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon", meta = (ClampMin = 0.0f))
 	float BulletSpread;
@@ -125,14 +346,44 @@ protected:
 
 	float LastFireTime;
 
-//Time Handle
+	uint32 ShotCounter;
+
+	// Picked by the server, together with the shot counter it seeds the spread of every shot
+	UPROPERTY(Replicated)
+	int32 SpreadSeed;
+
+//Shot Batching
 
-	FTimerHandle TimerHandle_TimeBetweenShots;
+	// Shots predicted on this client that the server has not acknowledged yet, the last NumUnsentShots have not been sent at all
+	TArray<FSShotRecord> UnackedShots;
+
+	// Client shot counter of the first unacknowledged shot
+	uint32 UnackedFirstShotIndex;
+
+	int32 NumUnsentShots;
+
+	float LastShotBatchTime;
+
+	// When the server last acknowledged shots, or the first of the shots it has yet to acknowledge was sent
+	float LastAckProgressTime;
+
+	// Server only, number of client shots that have been traced or reconciled
+	uint32 ServerShotIndex;
+
+	// Shots up to here have been processed by the server, replicated to the owner only
+	UPROPERTY(ReplicatedUsing=OnRep_AckedShotIndex)
+	uint32 AckedShotIndex;
+
+	// Number of reloads, corrections from before the client's latest reload are ignored
+	uint8 ReloadCounter;
 
 //Hit Scan Trace
 
-	UPROPERTY(ReplicatedUsing=OnRep_HitScanTrace)
-	FHitScanTrace HitScanTrace;
+	UPROPERTY(ReplicatedUsing=OnRep_HitScanBurst)
+	FSHitScanBurst HitScanBurst;
+
+	// Remote clients only, burst counter of the last shot that played its FX
+	uint8 LastPlayedBurstCounter;
 
 public:	
 
@@ -140,10 +391,22 @@ public:
 
 	void StartFire();
 
-	void StopFire();
+	/* bInterrupt also cuts off bursts still being fired, for weapons being put away */
+	void StopFire(bool bInterrupt = false);
 
 	void ReloadWeapon();
 
+	/* Server only. Refills the weapon to the ammo it started the match with, when the player gets a new pawn */
+	void Restock();
+
+	/**
+	 * Traces a recorded shot again with its recorded aim, eye point, shot index and timing (used by replay playback).
+	 * Ammo, shot counter and spread seed of the weapon stay as they are, the replay manager checks ammo and seed against the stream.
+	 */
+	void FireReplayShot(const FSReplayShot& Shot);
+
+	int32 GetSpreadSeed() const { return SpreadSeed; }
+
 // ------- VARIABLES ------- \\
 
 //Float
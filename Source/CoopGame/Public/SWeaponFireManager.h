@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SWorldManager.h"
+#include "SWeaponFireManager.generated.h"
+
+class ASWeapon;
+
+
+/**
+ * Fires every weapon of the world whose trigger is held or whose burst is not done from one update,
+ * instead of a looping timer per weapon.
+ *
+ * Each firing weapon keeps the world time its next shot is due. Every frame all shots that came due since the last
+ * update are fired, each with its own time and an aim blended between the last and the current eye point, so the rate
+ * of fire does not depend on the frame rate and does not drift at low tick rates.
+ */
+UCLASS()
+class COOPGAME_API ASWeaponFireManager : public ASWorldManager
+{
+	GENERATED_BODY()
+
+public:
+
+	ASWeaponFireManager();
+
+	/**
+	 * Starts firing Weapon, its first shot is due at FirstShotTime (world time), right away if that has passed.
+	 * Stops by itself after NumShots shots, or fires until StopFiring when NumShots is 0.
+	 */
+	void StartFiring(ASWeapon* Weapon, float FirstShotTime, int32 NumShots = 0);
+
+	void StopFiring(ASWeapon* Weapon);
+
+	bool IsFiring(const ASWeapon* Weapon) const;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+protected:
+
+	struct FFiringWeapon
+	{
+		TWeakObjectPtr<ASWeapon> Weapon;
+
+		// World time the next shot is due
+		float NextShotTime;
+
+		// Eye point of the owner at the last update, shots between two updates blend from here
+		FVector LastEyeLocation;
+
+		FRotator LastEyeRotation;
+
+		float LastUpdateTime;
+
+		// Shots left to fire, 0 for no limit
+		int32 ShotsRemaining;
+	};
+
+	TArray<FFiringWeapon> FiringWeapons;
+};
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SWeaponFireModes.generated.h"
+
+
+UENUM(BlueprintType)
+enum class ESFireMode : uint8
+{
+	// Fires for as long as the trigger is held
+	Automatic,
+
+	// One shot per trigger pull
+	SemiAutomatic,
+
+	// BurstCount shots per trigger pull, the burst finishes even if the trigger is let go
+	Burst,
+
+	// One shot of PelletCount pellets per trigger pull
+	Shotgun,
+};
+
+
+/**
+ * Compile time policies behind the fire modes. A weapon picks the policy of its fire mode once per trigger pull or shot
+ * and runs code specialized for it, so shots make no virtual calls and single bullet modes carry no pellet code.
+ */
+struct FSFireModeAutomatic
+{
+	// Shots per trigger pull, 0 for as long as the trigger is held
+	static int32 GetShotsPerTrigger(int32 BurstCount) { return 0; }
+
+	// Letting go of the trigger stops shots that are still due
+	static constexpr bool bStopsOnRelease = true;
+
+	// Shots are made of several pellets traced together
+	static constexpr bool bPellets = false;
+};
+
+
+struct FSFireModeSemiAutomatic
+{
+	static int32 GetShotsPerTrigger(int32 BurstCount) { return 1; }
+
+	static constexpr bool bStopsOnRelease = false;
+
+	static constexpr bool bPellets = false;
+};
+
+
+struct FSFireModeBurst
+{
+	static int32 GetShotsPerTrigger(int32 BurstCount) { return FMath::Max(BurstCount, 1); }
+
+	static constexpr bool bStopsOnRelease = false;
+
+	static constexpr bool bPellets = false;
+};
+
+
+struct FSFireModeShotgun
+{
+	static int32 GetShotsPerTrigger(int32 BurstCount) { return 1; }
+
+	static constexpr bool bStopsOnRelease = false;
+
+	static constexpr bool bPellets = true;
+};
+
+
+/* Calls Func with the policy of FireMode, as Func(FSFireModeXxx()) */
+template <typename FuncType>
+FORCEINLINE void DispatchFireMode(ESFireMode FireMode, FuncType&& Func)
+{
+	switch (FireMode)
+	{
+	case ESFireMode::SemiAutomatic:
+		Func(FSFireModeSemiAutomatic());
+		break;
+	case ESFireMode::Burst:
+		Func(FSFireModeBurst());
+		break;
+	case ESFireMode::Shotgun:
+		Func(FSFireModeShotgun());
+		break;
+	default:
+		Func(FSFireModeAutomatic());
+		break;
+	}
+}
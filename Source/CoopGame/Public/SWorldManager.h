@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "SWorldManager.generated.h"
+
+
+/**
+ * Base for non-replicated, per-world manager actors (one instance per class per world).
+ * Managers are spawned on first use and looked up through Get<T>() without iterating actors.
+ */
+UCLASS(Abstract, NotPlaceable, Transient)
+class COOPGAME_API ASWorldManager : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+
+	ASWorldManager();
+
+	/* Returns the manager of type T for the world of WorldContextObject, spawning it if needed */
+	template<typename T>
+	static T* Get(const UObject* WorldContextObject, bool bCreateIfMissing = true)
+	{
+		return static_cast<T*>(GetOrCreate(WorldContextObject, T::StaticClass(), bCreateIfMissing));
+	}
+
+protected:
+
+	virtual void PostInitializeComponents() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+
+	static ASWorldManager* GetOrCreate(const UObject* WorldContextObject, UClass* ManagerClass, bool bCreateIfMissing);
+
+	static TMap<TPair<const UWorld*, const UClass*>, TWeakObjectPtr<ASWorldManager>> Managers;
+};
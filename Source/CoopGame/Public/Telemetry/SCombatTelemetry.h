@@ -0,0 +1,156 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Atomic.h"
+
+class AActor;
+class FRunnableThread;
+class FSCombatTelemetryWriter;
+
+
+// File identifier and format version of combat telemetry files
+#define STELEMETRY_MAGIC			0x4C455443 // 'CTEL'
+#define STELEMETRY_VERSION			1
+
+
+enum class ESTelemetryEvent : uint8
+{
+	// Value = damage, Value2 = health after
+	Damage,
+
+	// Value = heal amount, Value2 = health after
+	Heal,
+
+	// Subject = victim, Other = killer, Value = killing damage
+	Kill,
+
+	// Value = health at spawn
+	Spawn,
+
+	// Value = damage, Value2 = radius
+	Explosion,
+
+	// Subject = game state, Value = new wave state, Value2 = wave number
+	WaveState,
+};
+
+
+/* Fixed size telemetry event, written to disk as is */
+struct FSTelemetryRecord
+{
+	// World time in seconds
+	float Time;
+
+	uint32 Frame;
+
+	uint8 Type;
+
+	uint8 SubjectTeam;
+
+	uint8 OtherTeam;
+
+	uint8 Reserved;
+
+	// UObject unique ids of the actors involved (0 if none)
+	uint32 SubjectId;
+
+	uint32 OtherId;
+
+	float Value;
+
+	float Value2;
+
+	float Location[3];
+};
+
+static_assert(sizeof(FSTelemetryRecord) == 40, "Telemetry records are part of the file format, keep them fixed size");
+
+
+/* File header, followed by tightly packed FSTelemetryRecords so the file can be memory mapped and read in place */
+struct FSTelemetryFileHeader
+{
+	uint32 Magic;
+
+	uint16 Version;
+
+	uint16 RecordSize;
+
+	// UTC ticks of the start of the recording
+	int64 StartTime;
+};
+
+static_assert(sizeof(FSTelemetryFileHeader) == 16, "Telemetry header is part of the file format, keep it fixed size");
+
+
+/**
+ * Combat telemetry without string formatting or file I/O on the game thread.
+ * Events are pushed into a lock-free multi-producer single-consumer ring buffer and drained to disk by a background thread.
+ *
+ * Enable with -CombatTelemetry or COOP.Telemetry 1. Files go to Saved/Telemetry and are converted with the STelemetryToCSV commandlet.
+ */
+class COOPGAME_API FSCombatTelemetry
+{
+public:
+
+	static void Record(ESTelemetryEvent Type, const AActor* Subject, const AActor* Other, float Value, float Value2 = 0.0f);
+
+	static bool IsEnabled();
+
+	/* Flushes and closes the file. Final, events recorded after this are ignored. */
+	static void Shutdown();
+
+	// Records the buffer can hold before new events are dropped, must be a power of two
+	static const uint32 Capacity = 16384;
+
+private:
+
+	FSCombatTelemetry();
+
+	~FSCombatTelemetry();
+
+	static FSCombatTelemetry& Get();
+
+	bool Push(const FSTelemetryRecord& Record);
+
+	bool Pop(FSTelemetryRecord& OutRecord);
+
+	/* Starts the writer on the first event, false once shut down */
+	bool StartWriter();
+
+	void StopWriter();
+
+	enum EWriterState : uint8
+	{
+		WRITER_NotStarted,
+		WRITER_Running,
+		WRITER_ShutDown,
+	};
+
+	struct FSlot
+	{
+		TAtomic<uint32> Sequence;
+
+		FSTelemetryRecord Record;
+	};
+
+	FSlot* Slots;
+
+	TAtomic<uint32> EnqueuePos;
+
+	// Only touched by the writer thread
+	uint32 DequeuePos;
+
+	TAtomic<uint32> NrOfDroppedRecords;
+
+	// EWriterState, read by every Record without taking the writer lock
+	TAtomic<uint8> WriterState;
+
+	// Only touched with the writer lock held
+	FSCombatTelemetryWriter* Writer;
+
+	FRunnableThread* WriterThread;
+
+	friend class FSCombatTelemetryWriter;
+};
@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "STelemetryToCSVCommandlet.generated.h"
+
+
+/**
+ * Converts a combat telemetry file (.ctel) to CSV.
+ *
+ * UE4Editor-Cmd.exe CoopGame.uproject -run=STelemetryToCSV -In=<file.ctel> [-Out=<file.csv>]
+ */
+UCLASS()
+class COOPGAME_API USTelemetryToCSVCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	USTelemetryToCSVCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};